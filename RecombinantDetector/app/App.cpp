@@ -116,6 +116,58 @@ void App::logSettings() {
 	(*this) << "Sequences to read limit enabled: " << settings.sequencesToReadLimitEnabled << endl;
 	(*this) << "Sequences to read limit: " << settings.sequencesToReadLimit << endl;
 	(*this) << "P-table file path: " << settings.pTableFilePath << endl;
+	(*this) << "P-table loading: ";
+	switch (settings.pTableLoading) {
+	case UserSettings::PTableLoading::Read:
+		(*this) << "read" << endl;
+		break;
+	case UserSettings::PTableLoading::MapPrefetch:
+		(*this) << "mapPrefetch" << endl;
+		break;
+	default:
+		(*this) << "map" << endl;
+	}
+	(*this) << "P-table verification enabled: " << settings.verifyPTable << endl;
+	(*this) << "P-table encoding: "
+		<< (settings.pTableEncoding == UserSettings::PTableEncoding::Log16 ? "log16" : "float32") << endl;
+	(*this) << "P-table generation threads count: " << settings.pTableThreadsCount << endl;
+	(*this) << "P-table auto size enabled: " << settings.pTableAutoSize << endl;
+	(*this) << "P-table cache directory: " << settings.pTableCacheDirectory << endl;
+	(*this) << "P-table auto size sample: " << settings.pTableAutoSizeSample << endl;
+	(*this) << "P-table auto size limit: " << settings.pTableAutoSizeLimit << endl;
+	(*this) << "Triplet storage: ";
+	switch (settings.tripletStorage) {
+	case UserSettings::TripletStorage::All:
+		(*this) << "all";
+		if (settings.tripletMemoryLimitMB != 0) {
+			(*this) << ", spilled over " << settings.tripletMemoryLimitMB << " MB";
+		}
+		(*this) << endl;
+		break;
+	case UserSettings::TripletStorage::TopK:
+		(*this) << "topK, " << settings.topTripletsPerChild << " per child" << endl;
+		break;
+	case UserSettings::TripletStorage::Summary:
+		(*this) << "summary" << endl;
+		break;
+	default:
+		(*this) << "best" << endl;
+	}
+	(*this) << "Detection engine: ";
+	switch (settings.detectionEngine) {
+	case UserSettings::DetectionEngine::BitSliced:
+		(*this) << "bitSliced" << endl;
+		break;
+	case UserSettings::DetectionEngine::Dense:
+		(*this) << "dense, SIMD level: " << settings.simdLevel << endl;
+		break;
+	default:
+		(*this) << "pairIndex" << endl;
+	}
+	(*this) << "Correction method: "
+		<< (settings.correctionMethod == UserSettings::CorrectionMethod::Bonferroni ? "bonferroni" : "dunnSidak") << endl;
+	(*this) << "P-value histogram bins per decade: " << settings.pValHistogramBinsPerDecade << endl;
+	(*this) << "P-value histogram sampling: " << settings.pValHistogramSampling << endl;
 	showLog(true);
 }
 
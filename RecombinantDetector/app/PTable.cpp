@@ -1,8 +1,96 @@
 
 #include "PTable.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
 #include "PTableFile.h"
 #include "UserSettings.h"
 #include "App.h"
+#include "../utils/ThreadPool.h"
+
+namespace {
+	/* The side of the square tiles of (m, n) cells generated by one task */
+	const long WAVEFRONT_TILE_SIZE = 64;
+
+	/* The number of values zeroed by one task */
+	const long ZEROING_CHUNK_SIZE = 1 << 20;
+
+	/* The number of values encoded or decoded by one task */
+	const long ENCODING_CHUNK_SIZE = 1 << 20;
+
+	/**
+	 * Run task(begin, end) on the chunks of [first, last) and wait for all of them.
+	 * Without a pool, the whole range is a single chunk run on the calling thread.
+	 */
+	template <class Task>
+	void runChunks(ThreadPool* pool, const long& first, const long& last, const long& chunkSize, const Task& task) {
+		if (pool == nullptr) {
+			task(first, last);
+			return;
+		}
+		std::vector<std::future<void>> chunks;
+		for (auto begin = first; begin < last; begin += chunkSize) {
+			auto end = std::min(begin + chunkSize, last);
+			chunks.push_back(pool->enqueue([&task, begin, end] { task(begin, end); }));
+		}
+		for (auto&& chunk : chunks) chunk.get();
+	}
+
+	/**
+	 * Call cell(m, n) for 1 <= m <= mSize and minN <= n <= min(minN + m, nSize), where a cell
+	 * depends on (m-1, n) and (m, n-1) only. The cells are grouped into tiles, and the tiles of
+	 * an anti-diagonal are run in parallel once the previous anti-diagonal is done.
+	 * Every cell is computed from the same values as in the serial order.
+	 */
+	template <class Cell>
+	void runWavefront(ThreadPool* pool, const long& mSize, const long& minN, const long& nSize, const Cell& cell) {
+		if (pool == nullptr) {
+			for (long m = 1; m <= mSize; m++) {
+				auto maxN = std::min(minN + m, nSize);
+				for (auto n = minN; n <= maxN; n++) {
+					cell(m, n);
+				}
+			}
+			return;
+		}
+		if (nSize < minN) {
+			return;
+		}
+
+		auto mTileCount = (mSize + WAVEFRONT_TILE_SIZE - 1) / WAVEFRONT_TILE_SIZE;
+		auto nTileCount = (nSize - minN + WAVEFRONT_TILE_SIZE) / WAVEFRONT_TILE_SIZE;
+		auto runTile = [&](long mTileIdx, long nTileIdx) {
+			auto firstM = 1 + mTileIdx * WAVEFRONT_TILE_SIZE;
+			auto lastM = std::min(firstM + WAVEFRONT_TILE_SIZE - 1, mSize);
+			auto firstN = minN + nTileIdx * WAVEFRONT_TILE_SIZE;
+			auto lastN = std::min(firstN + WAVEFRONT_TILE_SIZE - 1, nSize);
+			for (auto m = firstM; m <= lastM; m++) {
+				auto maxN = std::min(minN + m, lastN);
+				for (auto n = firstN; n <= maxN; n++) {
+					cell(m, n);
+				}
+			}
+		};
+
+		std::vector<std::future<void>> tiles;
+		for (long diagonal = 0; diagonal < mTileCount + nTileCount - 1; diagonal++) {
+			tiles.clear();
+			auto firstMTileIdx = std::max(0L, diagonal - nTileCount + 1);
+			auto lastMTileIdx = std::min(diagonal, mTileCount - 1);
+			for (auto mTileIdx = firstMTileIdx; mTileIdx <= lastMTileIdx; mTileIdx++) {
+				auto nTileIdx = diagonal - mTileIdx;
+				// The tiles right of n = minN + m have no cell
+				if (nTileIdx * WAVEFRONT_TILE_SIZE > (mTileIdx + 1) * WAVEFRONT_TILE_SIZE) {
+					continue;
+				}
+				tiles.push_back(pool->enqueue([&runTile, mTileIdx, nTileIdx] { runTile(mTileIdx, nTileIdx); }));
+			}
+			for (auto&& tile : tiles) tile.get();
+		}
+	}
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //  STATIC CONSTANTS
@@ -14,19 +102,41 @@ const double PTable::NaPVAL = -1.0;
 const double PTable::BYTE_IN_MB = 1048576.0;
 const double PTable::FLOAT_SIZE = static_cast<double> (sizeof(float));
 
+const std::vector<float> PTable::LOG16_DECODING = [] {
+	std::vector<float> decoding(LOG16_ZERO_CODE + 1);
+	for (size_t code = 0; code < LOG16_ZERO_CODE; code++) {
+		decoding[code] = static_cast<float>(exp2(-static_cast<double>(code) / (1 << LOG16_FRACTION_BITS)));
+	}
+	decoding[LOG16_ZERO_CODE] = 0.0f;
+	return decoding;
+}();
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void PTable::clearTable() {
+	waitForVerification();
+	isCorrupt = false;
+
 	if (indexArray) {
 		delete[] indexArray;
 		indexArray = nullptr;
 	}
+	indexValues = nullptr;
 
 	if (table) {
 		delete[] table;
 		table = nullptr;
 	}
 
+	if (codeTable) {
+		delete[] codeTable;
+		codeTable = nullptr;
+	}
+
+	mappedFile.reset();
+	values = nullptr;
+	codes = nullptr;
+
 	if (ykTableForLastK) {
 		delete ykTableForLastK;
 		ykTableForLastK = nullptr;
@@ -61,7 +171,8 @@ long PTable::estimateMemNeededInMB(const long& newMSize,
 long PTable::initIndexArray() {
 	assert(indexArray == nullptr);
 
-	indexArray = new long[mSize * nSize];
+	indexArray = new int64_t[mSize * nSize];
+	indexValues = indexArray;
 
 	long totalNumOfStoredPVals = 0;
 
@@ -73,11 +184,7 @@ long PTable::initIndexArray() {
 	for (long m = 1; m <= mSize; m++) {
 		for (long n = 1; n <= nSize; n++) {
 			indexArray[(m - 1) * nSize + n - 1] = totalNumOfStoredPVals;
-
-			long minK = (n - m + 1 > 2) ? n - m + 1 : 2;
-			long maxK = (n < kSize) ? n : kSize;
-			long numOfAcceptedK = (maxK >= minK) ? maxK - minK + 1 : 0;
-			totalNumOfStoredPVals += numOfAcceptedK;
+			totalNumOfStoredPVals += numOfAcceptedK(m, n, kSize);
 		}
 	}
 
@@ -86,24 +193,206 @@ long PTable::initIndexArray() {
 
 void PTable::initialize(const long& newMSize,
 	const long& newNSize,
-	const long& newKSize) {
+	const long& newKSize,
+	const Encoding& newEncoding) {
 	clearTable();
 
 	mSize = newMSize;
 	nSize = newNSize;
 	kSize = newKSize;
+	encoding = newEncoding;
 
 	assert(mSize > 0 && nSize > 0 && kSize > 0);
 	numStoredVals = initIndexArray();
 
-	table = new(nothrow) float[numStoredVals];
+	if (encoding == Encoding::Log16) {
+		codeTable = new(nothrow) uint16_t[numStoredVals];
+		codes = codeTable;
+	}
+	else {
+		table = new(nothrow) float[numStoredVals];
+		values = table;
+	}
 
-	if (!table) {
+	if (!table && !codeTable) {
 		App::instance() << "Unable to allocate savedTriplets for the P-value table.\n";
 		App::instance().showError(true, true);
 	}
 }
 
+bool PTable::initializeMapped(const long& newMSize,
+	const long& newNSize,
+	const long& newKSize,
+	std::unique_ptr<MappedFile> file,
+	const size_t& dataOffset,
+	const size_t& indexOffset,
+	const Encoding& newEncoding) {
+	clearTable();
+
+	mSize = newMSize;
+	nSize = newNSize;
+	kSize = newKSize;
+	encoding = newEncoding;
+
+	assert(mSize > 0 && nSize > 0 && kSize > 0);
+	assert(dataOffset % valueSize(encoding) == 0 && indexOffset % alignof(int64_t) == 0);
+	if (indexOffset == 0) {
+		numStoredVals = initIndexArray();
+	}
+	else {
+		if (file->size() < indexOffset + mSize * nSize * sizeof(int64_t)) {
+			return false;
+		}
+		indexValues = reinterpret_cast<const int64_t*>(file->data() + indexOffset);
+		numStoredVals = indexValues[mSize * nSize - 1] + numOfAcceptedK(mSize, nSize, kSize);
+	}
+
+	if (file->size() < dataOffset + numStoredVals * valueSize(encoding)) {
+		return false;
+	}
+
+	if (encoding == Encoding::Log16) {
+		codes = reinterpret_cast<const uint16_t*>(file->data() + dataOffset);
+	}
+	else {
+		values = reinterpret_cast<const float*>(file->data() + dataOffset);
+	}
+	mappedFile = std::move(file);
+	return true;
+}
+
+uint16_t PTable::encodeLog16(const float& pValue) {
+	if (!(pValue > 0.0f)) {
+		return LOG16_ZERO_CODE;
+	}
+	auto code = std::round(-std::log2(static_cast<double>(pValue)) * (1 << LOG16_FRACTION_BITS));
+	if (code <= 0.0) {
+		// p = 1, or slightly above after the rounding of the floats
+		return 0;
+	}
+	if (code >= LOG16_ZERO_CODE) {
+		return LOG16_ZERO_CODE;
+	}
+	return static_cast<uint16_t>(code);
+}
+
+void PTable::encode(const Encoding& newEncoding) {
+	if (newEncoding == encoding || numStoredVals == 0) {
+		encoding = newEncoding;
+		return;
+	}
+
+	// The values may be read by the check of a mapped file, which is released below
+	waitForVerification();
+
+	auto threadCount = workerThreadCount();
+	std::unique_ptr<ThreadPool> pool;
+	if (threadCount > 1) {
+		pool = std::make_unique<ThreadPool>(threadCount);
+	}
+
+	if (newEncoding == Encoding::Log16) {
+		codeTable = new(nothrow) uint16_t[numStoredVals];
+		if (!codeTable) {
+			App::instance() << "Unable to allocate memory for the encoded P-value table.\n";
+			App::instance().showError(true, true);
+		}
+
+		// The errors of the codes in the significance region and over all the values
+		std::mutex errorsMutex;
+		double maxSignificantError = 0.0;
+		double maxError = 0.0;
+		long significantCount = 0;
+		long zeroedCount = 0;
+		auto rejectThreshold = UserSettings::instance().rejectThreshold;
+		runChunks(pool.get(), 0, numStoredVals, ENCODING_CHUNK_SIZE, [&](long begin, long end) {
+			double chunkSignificantError = 0.0, chunkError = 0.0;
+			long chunkSignificantCount = 0, chunkZeroedCount = 0;
+			for (auto i = begin; i < end; i++) {
+				auto code = encodeLog16(values[i]);
+				codeTable[i] = code;
+				if (values[i] <= 0.0f) {
+					continue;
+				}
+				if (code == LOG16_ZERO_CODE) {
+					chunkZeroedCount++;
+					continue;
+				}
+				auto error = std::fabs(static_cast<double>(decodeLog16(code)) - values[i]) / values[i];
+				chunkError = std::max(chunkError, error);
+				if (values[i] <= rejectThreshold) {
+					chunkSignificantError = std::max(chunkSignificantError, error);
+					chunkSignificantCount++;
+				}
+			}
+			std::lock_guard<std::mutex> lock(errorsMutex);
+			maxSignificantError = std::max(maxSignificantError, chunkSignificantError);
+			maxError = std::max(maxError, chunkError);
+			significantCount += chunkSignificantCount;
+			zeroedCount += chunkZeroedCount;
+			});
+
+		App::instance()
+			<< "The P-value table is encoded to log16, the maximum relative error is\n"
+			<< App::DEFAULT_INDENT << maxSignificantError << " for the " << significantCount
+			<< " p-values <= " << rejectThreshold << ",\n"
+			<< App::DEFAULT_INDENT << maxError << " for all the p-values, "
+			<< zeroedCount << " p-values below ~2^-128 are stored as 0.\n";
+		App::instance().showLog(true);
+	}
+	else {
+		table = new(nothrow) float[numStoredVals];
+		if (!table) {
+			App::instance() << "Unable to allocate memory for the decoded P-value table.\n";
+			App::instance().showError(true, true);
+		}
+		runChunks(pool.get(), 0, numStoredVals, ENCODING_CHUNK_SIZE, [this](long begin, long end) {
+			for (auto i = begin; i < end; i++) {
+				table[i] = decodeLog16(codes[i]);
+			}
+			});
+	}
+
+	// Release the values of the old encoding
+	if (indexArray == nullptr) {
+		initIndexArray();
+	}
+	if (newEncoding == Encoding::Log16) {
+		delete[] table;
+		table = nullptr;
+		values = nullptr;
+		codes = codeTable;
+	}
+	else {
+		delete[] codeTable;
+		codeTable = nullptr;
+		codes = nullptr;
+		values = table;
+	}
+	mappedFile.reset();
+	encoding = newEncoding;
+}
+
+void PTable::verifyInBackground(std::function<bool()> verify) {
+	waitForVerification();
+	verification = std::async(std::launch::async, std::move(verify));
+}
+
+bool PTable::waitForVerification() {
+	if (verification.valid() && !verification.get()) {
+		isCorrupt = true;
+	}
+	return !isCorrupt;
+}
+
+size_t PTable::workerThreadCount() {
+	size_t threadCount = UserSettings::instance().pTableThreadsCount;
+	if (threadCount == 0) {
+		threadCount = std::max(1U, std::thread::hardware_concurrency());
+	}
+	return threadCount;
+}
+
 void PTable::generateTable(const long& newMSize,
 	const long& newNSize,
 	const long& newKSize) {
@@ -117,7 +406,14 @@ void PTable::generateTable(const long& newMSize,
 
 	initialize(newMSize, newNSize, newKSize);
 
-	ykTableForLastK = new YkTable(mSize, nSize, kSize);
+	// The layers of k are generated one after another, the cells of a layer in parallel
+	auto threadCount = workerThreadCount();
+	std::unique_ptr<ThreadPool> pool;
+	if (threadCount > 1) {
+		pool = std::make_unique<ThreadPool>(threadCount);
+	}
+
+	ykTableForLastK = new YkTable(mSize, nSize, kSize, pool.get());
 
 	time_t lastTime = time(nullptr) - UserSettings::instance().UpdateMonitorInSec - 1;
 	App::instance().initCounter("Generating P-value table", 2, kSize);
@@ -132,16 +428,12 @@ void PTable::generateTable(const long& newMSize,
 			lastTime = currentTime;
 		}
 
-		ykTableForLastK->generateTable(k - 1);
+		ykTableForLastK->generateTable(k - 1, pool.get());
 
-		for (long m = 1; m <= mSize; m++) {
-
-			/* Since n < k and n >= m + k are special cases */
-			long maxN = (m + k < nSize) ? m + k : nSize;
-			for (long n = k; n <= maxN; n++) {
-				calculatePVal(m, n, k);
-			}
-		}
+		/* Since n < k and n >= m + k are special cases */
+		runWavefront(pool.get(), mSize, k, nSize, [this, k](long m, long n) {
+			calculatePVal(m, n, k);
+			});
 
 	}
 	App::instance().finishCounting();
@@ -193,7 +485,7 @@ bool PTable::saveToFile(const string& fileName) const {
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-PTable::YkTable::YkTable(long newMSize, long newNSize, long newJSize) {
+PTable::YkTable::YkTable(long newMSize, long newNSize, long newJSize, ThreadPool* pool) {
 	mSize = newMSize;
 	nSize = newNSize;
 	jSize = newJSize;
@@ -211,10 +503,11 @@ PTable::YkTable::YkTable(long newMSize, long newNSize, long newJSize) {
 		App::instance().showError(true, true);
 	}
 
-	/* Initialise to reduce later calculation */
-	for (long i = 0; i < numStoredVals; i++) {
-		table[i] = 0.0f;
-	}
+	/* Initialise to reduce later calculation. The pages are first touched by the threads
+	 * that generate the table */
+	runChunks(pool, 0, numStoredVals, ZEROING_CHUNK_SIZE, [this](long begin, long end) {
+		std::fill(table + begin, table + end, 0.0f);
+		});
 }
 
 PTable::YkTable::~YkTable() {
@@ -255,7 +548,7 @@ long PTable::YkTable::initIndexArray() {
 	return totalNumOfValues;
 }
 
-void PTable::YkTable::generateTable(const long& k) {
+void PTable::YkTable::generateTable(const long& k, ThreadPool* pool) {
 	assert(k >= 1 && k <= jSize);
 
 	if (currentK < 0 || k == 1) {
@@ -276,68 +569,66 @@ void PTable::YkTable::generateTable(const long& k) {
 		 * cannot be generated without the layer of k-1 */
 		assert(k == currentK + 1);
 
-		/* Update lastYkk */
-		for (long m = 1; m <= mSize; m++) {
-			auto minN = k - 1; // k >= 2
-			auto maxN = k - 1 + m;
-			if (maxN > nSize) maxN = nSize;
+		/* Update lastYkk, the rows of m are independent */
+		runChunks(pool, 1, mSize + 1, WAVEFRONT_TILE_SIZE, [this, k](long firstM, long endM) {
+			for (auto m = firstM; m < endM; m++) {
+				auto minN = k - 1; // k >= 2
+				auto maxN = k - 1 + m;
+				if (maxN > nSize) maxN = nSize;
 
-			/* Since k > n and k+m < n are special cases */
-			for (auto n = minN; n <= maxN; n++) {
-				lastYkk[(m - 1) * nSize + n - 1] = getYValue(m, n, k - 1, k - 1);
+				/* Since k > n and k+m < n are special cases */
+				for (auto n = minN; n <= maxN; n++) {
+					lastYkk[(m - 1) * nSize + n - 1] = getYValue(m, n, k - 1, k - 1);
+				}
 			}
-		}
+			});
 	}
 
 	currentK = k;
 
-	/* Generate new layer */
-	for (long m = 1; m <= mSize; m++) {
-		auto maxN = currentK + m;
-		if (maxN > nSize) maxN = nSize;
-
-		/* Since k > n and k+m < n are special cases */
-		for (auto n = currentK; n <= maxN; n++) {
-			auto minJ = (n - m > 0) ? n - m : 0;
-			auto maxJ = (n < jSize) ? n : jSize;
+	/* Generate new layer. Since k > n and k+m < n are special cases */
+	runWavefront(pool, mSize, currentK, nSize, [this](long m, long n) {
+		generateCell(m, n);
+		});
+}
 
-			for (long j = minJ; j <= maxJ; j++) {
-				long ykIndex = get1DIndex(m, n, j);
-				assert(ykIndex >= 0 && ykIndex < numStoredVals);
+void PTable::YkTable::generateCell(const long& m, const long& n) {
+	auto k = currentK;
+	auto minJ = (n - m > 0) ? n - m : 0;
+	auto maxJ = (n < jSize) ? n : jSize;
 
-				auto fM = static_cast<float> (m);
-				auto fN = static_cast<float> (n);
+	for (long j = minJ; j <= maxJ; j++) {
+		long ykIndex = get1DIndex(m, n, j);
+		assert(ykIndex >= 0 && ykIndex < numStoredVals);
 
-				if (j == 0) {
-					table[ykIndex] = (fM / (fM + fN))
-						* (getYValue(m - 1, n, k, 1) + getYValue(m - 1, n, k, 0));
+		auto fM = static_cast<float> (m);
+		auto fN = static_cast<float> (n);
 
-				}
-				else if (j == currentK) {
-					float Y_m_nPre_kPre_kPre = 0.0f; // Y[m, n-1, k-1, k-1]
-					if (n == 1) {
-						if (currentK == 1) {
-							/* n-1 = k-1 = j-1 = 0 */
-							Y_m_nPre_kPre_kPre = 1.0f;
-						}
-					}
-					else {
-						Y_m_nPre_kPre_kPre = lastYkk[(m - 1) * nSize + (n - 1) - 1];
-					}
-
-					table[ykIndex] = (fN / (fM + fN))
-						* (Y_m_nPre_kPre_kPre + getYValue(m, n - 1, k, j - 1));
+		if (j == 0) {
+			table[ykIndex] = (fM / (fM + fN))
+				* (getYValue(m - 1, n, k, 1) + getYValue(m - 1, n, k, 0));
 
+		}
+		else if (j == currentK) {
+			float Y_m_nPre_kPre_kPre = 0.0f; // Y[m, n-1, k-1, k-1]
+			if (n == 1) {
+				if (currentK == 1) {
+					/* n-1 = k-1 = j-1 = 0 */
+					Y_m_nPre_kPre_kPre = 1.0f;
 				}
-				else {
-					table[ykIndex] = (fM * getYValue(m - 1, n, k, j + 1)
-						+ fN * getYValue(m, n - 1, k, j - 1)
-						) / (fM + fN);
-				}
+			}
+			else {
+				Y_m_nPre_kPre_kPre = lastYkk[(m - 1) * nSize + (n - 1) - 1];
+			}
 
+			table[ykIndex] = (fN / (fM + fN))
+				* (Y_m_nPre_kPre_kPre + getYValue(m, n - 1, k, j - 1));
 
-			}
+		}
+		else {
+			table[ykIndex] = (fM * getYValue(m - 1, n, k, j + 1)
+				+ fN * getYValue(m, n - 1, k, j - 1)
+				) / (fM + fN);
 		}
 	}
 }
-
@@ -3,20 +3,50 @@
 #include <fstream>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <ctime>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "../utils/MappedFile.h"
 #include "../utils/StatisticalUtils.h"
+#include "UserSettings.h"
 
 using namespace std;
 
+class ThreadPool;
+
 
 class PTable {
 public:
 	// Not a P-value. 
 	static const double NaPVAL;
 
+	typedef UserSettings::PTableEncoding Encoding;
+
+	/**
+	 * A Log16 code is -log2(p) in fixed point with LOG16_FRACTION_BITS fractional bits, so a
+	 * decoded value is within a relative error of 2^(2^-10) - 1 ~ 6.8e-4 of the float for all
+	 * p >= 2^-126 ~ 1.2e-38, the whole range of the significant p-values.
+	 * Smaller values are stored as LOG16_ZERO_CODE and decoded to 0.
+	 */
+	static const int LOG16_FRACTION_BITS = 9;
+	static const uint16_t LOG16_ZERO_CODE = 0xFFFF;
+
+	static uint16_t encodeLog16(const float& pValue);
+
+	static float decodeLog16(const uint16_t& code) {
+		return LOG16_DECODING[code];
+	}
+
+	// The size in bytes of a stored P-value
+	static size_t valueSize(const Encoding& encoding) {
+		return encoding == Encoding::Log16 ? sizeof(uint16_t) : sizeof(float);
+	}
+
 	~PTable() {
 		clearTable();
 	}
@@ -50,10 +80,38 @@ public:
 		return numStoredVals;
 	}
 
-	float* getDataPtr() const {
+	Encoding getEncoding() const {
+		return encoding;
+	}
+
+	// The P-values of a Float32 table, nullptr for a Log16 table
+	const float* getDataPtr() const {
+		return values;
+	}
+
+	// The codes of a Log16 table, nullptr for a Float32 table
+	const uint16_t* getCodesPtr() const {
+		return codes;
+	}
+
+	// The offsets of the (m, n) rows in the data, for m, n >= 1
+	const int64_t* getIndexArrayPtr() const {
+		return indexValues;
+	}
+
+	// The values of a table allocated by initialize(), nullptr for a mapped table
+	float* getWritableDataPtr() {
 		return table;
 	}
 
+	uint16_t* getWritableCodesPtr() {
+		return codeTable;
+	}
+
+	bool isMapped() const {
+		return mappedFile != nullptr;
+	}
+
 	bool canCalculateExact(const long& nUpSteps,
 		const long& nDownSteps,
 		const long& m_maxDescent) const {
@@ -97,7 +155,10 @@ public:
 		long index = get1DIndex(nUpSteps, nDownSteps, m_maxDescent);
 		assert(index >= 0 && index < numStoredVals);
 
-		return table[index];
+		if (codes) {
+			return decodeLog16(codes[index]);
+		}
+		return values[index];
 	}
 
 	static long double approxPValue(const long& nUpSteps,
@@ -109,8 +170,44 @@ public:
 	// Sets the new size and allocate the data
 	void initialize(const long& newMSize,
 		const long& newNSize,
-		const long& newKSize);
+		const long& newKSize,
+		const Encoding& newEncoding = Encoding::Float32);
+
+	/**
+	 * Sets the new size and use the values stored in a mapped file from dataOffset, the file is
+	 * kept mapped until the table is cleared. Returns false if the file is too short for the size.
+	 * @param indexOffset The offset of the index array stored in the file, 0 to build it
+	 */
+	bool initializeMapped(const long& newMSize,
+		const long& newNSize,
+		const long& newKSize,
+		std::unique_ptr<MappedFile> file,
+		const size_t& dataOffset,
+		const size_t& indexOffset = 0,
+		const Encoding& newEncoding = Encoding::Float32);
+
+	/**
+	 * Store the values in another encoding. Encoding a Float32 table to Log16 shows the errors of
+	 * the codes against the floats. A mapped table is copied into memory.
+	 */
+	void encode(const Encoding& newEncoding);
+
+	/**
+	 * Check the values in the background while the table is used, e.g. against the checksums
+	 * of its file. The table is not cleared before the check is done.
+	 */
+	void verifyInBackground(std::function<bool()> verify);
 
+	// Wait for the background check, returns false if the values are corrupt
+	bool waitForVerification();
+
+	// The threads generating or checking a table, from pTableThreadsCount
+	static size_t workerThreadCount();
+
+	/**
+	 * Generate the table on pTableThreadsCount threads. The layers of k are generated in order,
+	 * the cells of a layer on a wavefront, and the values are the same for any thread count.
+	 */
 	void generateTable(const long& newMSize,
 		const long& newNSize,
 		const long& newKSize);
@@ -123,6 +220,9 @@ private:
 	static const double BYTE_IN_MB;
 	static const double FLOAT_SIZE;
 
+	// The value of every Log16 code
+	static const std::vector<float> LOG16_DECODING;
+
 	/* Disable constructor and assignment for singleton */
 	PTable() {
 		maxMemInMB = -1; // -1 means unlimited
@@ -133,8 +233,14 @@ private:
 		numStoredVals = 0;
 
 		indexArray = nullptr;
+		indexValues = nullptr;
 		table = nullptr;
+		values = nullptr;
+		codeTable = nullptr;
+		codes = nullptr;
+		encoding = Encoding::Float32;
 		ykTableForLastK = nullptr;
+		isCorrupt = false;
 	}
 
 	PTable(const PTable& orig);
@@ -150,6 +256,15 @@ private:
 	 */
 	long initIndexArray();
 
+	/**
+	 * The number of P-values stored for (m, n).
+	 */
+	static long numOfAcceptedK(const long& m, const long& n, const long& kSize) {
+		long minK = (n - m + 1 > 2) ? n - m + 1 : 2;
+		long maxK = (n < kSize) ? n : kSize;
+		return (maxK >= minK) ? maxK - minK + 1 : 0;
+	}
+
 	/**
 	 * Translate 3D-index (nUpSteps, nDownSteps, maxDescent) into 1D-index.<br>
 	 * This index is used to access the P-value table.
@@ -162,7 +277,7 @@ private:
 		/* This function will only be called when nUpSteps, nDownSteps >= 1 and maxDescent >= 2 */
 		assert(nUpSteps >= 1 && nDownSteps >= 1 && m_maxDescent >= 2);
 
-		long mnIndex = indexArray[(nUpSteps - 1) * nSize + nDownSteps - 1];
+		long mnIndex = indexValues[(nUpSteps - 1) * nSize + nDownSteps - 1];
 
 		auto minK = (nDownSteps - nUpSteps + 1 > 2) ? nDownSteps - nUpSteps + 1 : 2;
 		auto kIndex = m_maxDescent - minK;
@@ -195,7 +310,12 @@ private:
 	 * The 2D array which will be used to find the 1D-index of P[m, n, k]
 	 * in the P-value table.
 	 */
-	long* indexArray;
+	int64_t* indexArray;
+
+	/**
+	 * The index array read by the lookups: indexArray, or the one stored in the mapped file.
+	 */
+	const int64_t* indexValues;
 
 	// &lt;     ~   <
 	// &nbsp;   ~   SPACE
@@ -216,6 +336,22 @@ private:
 	 */
 	float* table;
 
+	/**
+	 * The P-values read by the lookups: the table, or the data of the mapped file.
+	 */
+	const float* values;
+
+	// The P-values of a Log16 table, allocated or in the mapped file as the values
+	uint16_t* codeTable;
+	const uint16_t* codes;
+
+	Encoding encoding;
+
+	std::unique_ptr<MappedFile> mappedFile;
+
+	std::future<bool> verification;
+	bool isCorrupt;
+
 
 	class YkTable;
 
@@ -237,11 +373,18 @@ private:
  */
 class PTable::YkTable {
 public:
-	explicit YkTable(long newMSize, long newNSize, long newJSize);
+	/**
+	 * @param pool The threads zeroing the table, nullptr to zero it on the calling thread
+	 */
+	explicit YkTable(long newMSize, long newNSize, long newJSize, ThreadPool* pool);
 
 	~YkTable();
 
-	void generateTable(const long& k);
+	/**
+	 * Generate the layer of k from the layer of k-1.
+	 * @param pool The threads generating the cells, nullptr to generate them on the calling thread
+	 */
+	void generateTable(const long& k, ThreadPool* pool);
 
 	/**
 	 * Get Y[m, n, k, j].
@@ -303,6 +446,12 @@ private:
 	 */
 	long initIndexArray();
 
+	/**
+	 * Generate Yk[m, n, j] for all j of the current layer. The cells (m-1, n) and (m, n-1)
+	 * of the layer must be generated first.
+	 */
+	void generateCell(const long& m, const long& n);
+
 	/**
 	 * Translate 3D-index into 1D-index.<br>
 	 * This index is used to access the Yk-table.
@@ -0,0 +1,75 @@
+#include "PTableCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+std::string PTableCache::fileName(const long& mSize, const long& nSize, const long& kSize,
+	const PTable::Encoding& encoding) const {
+	return "ptable-" + std::to_string(mSize) + "x" + std::to_string(nSize) + "x" + std::to_string(kSize)
+		+ (encoding == PTable::Encoding::Log16 ? "-log16" : "-float32");
+}
+
+std::string PTableCache::findCovering(const long& mSize, const long& nSize, const long& kSize,
+	const PTable::Encoding& encoding) const {
+	std::error_code error;
+	std::filesystem::directory_iterator entries(m_directoryPath, error);
+	if (error) {
+		return "";
+	}
+
+	std::string bestPath;
+	uintmax_t bestFileSize = 0;
+	for (const auto& entry : entries) {
+		if (!entry.is_regular_file(error)) {
+			continue;
+		}
+
+		long cachedMSize, cachedNSize, cachedKSize;
+		char cachedEncoding[16] = {};
+		auto name = entry.path().filename().string();
+		if (sscanf(name.c_str(), "ptable-%ldx%ldx%ld-%15s", &cachedMSize, &cachedNSize, &cachedKSize, cachedEncoding) != 4
+			|| name != fileName(cachedMSize, cachedNSize, cachedKSize, encoding)) {
+			continue;
+		}
+		if (cachedMSize < mSize || cachedNSize < nSize || cachedKSize < kSize) {
+			continue;
+		}
+
+		// The tables are of the same encoding, so the smallest file holds the fewest values
+		auto fileSize = entry.file_size(error);
+		if (error) {
+			continue;
+		}
+		if (bestPath.empty() || fileSize < bestFileSize) {
+			bestPath = entry.path().string();
+			bestFileSize = fileSize;
+		}
+	}
+	return bestPath;
+}
+
+bool PTableCache::store(const PTable& pTable, std::string& path) const {
+	std::error_code error;
+	std::filesystem::create_directories(m_directoryPath, error);
+	if (error) {
+		return false;
+	}
+
+	auto name = fileName(pTable.getMSize(), pTable.getNSize(), pTable.getKSize(), pTable.getEncoding());
+	path = (std::filesystem::path(m_directoryPath) / name).string();
+
+	// Another run may look for the table or write it at the same time, so it only ever sees a whole file
+	auto partialPath = path + ".partial-" + std::to_string(std::random_device{}());
+	if (!pTable.saveToFile(partialPath)) {
+		std::filesystem::remove(partialPath, error);
+		return false;
+	}
+	std::filesystem::rename(partialPath, path, error);
+	if (error) {
+		std::filesystem::remove(partialPath, error);
+		return false;
+	}
+	return true;
+}
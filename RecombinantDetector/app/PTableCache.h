@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "PTable.h"
+
+/**
+ * A directory of P-value tables named by their sizes and encoding, e.g.
+ * "ptable-300x300x120-float32". A run takes the smallest cached table covering the sizes
+ * it needs, or generates one of exactly these sizes and stores it for the next runs.
+ */
+class PTableCache {
+public:
+	explicit PTableCache(const std::string& directoryPath) : m_directoryPath(directoryPath) {
+	}
+
+	/**
+	 * The path of the cached table of the encoding with the fewest values that covers the sizes,
+	 * empty if there is none.
+	 */
+	std::string findCovering(const long& mSize, const long& nSize, const long& kSize,
+		const PTable::Encoding& encoding) const;
+
+	// Store a table in the cache, replacing the file of its sizes at once
+	bool store(const PTable& pTable, std::string& path) const;
+
+private:
+	std::string fileName(const long& mSize, const long& nSize, const long& kSize,
+		const PTable::Encoding& encoding) const;
+
+	std::string m_directoryPath;
+};
@@ -1,5 +1,10 @@
 #include "PTableFile.h"
-#include "PTableFile.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 #include "../utils/Utils.h"
 #include "UserSettings.h"
@@ -7,6 +12,64 @@
 #include "App.h"
 
 const char PTableFile::FILE_MARKER[] = "P-table";
+const char PTableFile::FILE_MAGIC[] = "PTABLEv";
+
+namespace {
+	uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// FNV-1a over 64-bit words, the last word is padded with zeros
+	uint64_t checksum(const char* data, const uint64_t& size) {
+		uint64_t hash = 14695981039346656037ULL;
+		uint64_t offset = 0;
+		for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, data + offset, sizeof(uint64_t));
+			hash = (hash ^ word) * 1099511628211ULL;
+		}
+		if (offset < size) {
+			uint64_t word = 0;
+			memcpy(&word, data + offset, size - offset);
+			hash = (hash ^ word) * 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	// Check the blocks of the values against their checksums, the blocks are split between the threads
+	bool verifyBlocks(const char* data, const uint64_t& dataSize, const std::vector<uint64_t>& checksums,
+		const uint64_t& blockBytes, size_t threadCount) {
+		std::atomic<size_t> nextBlockIdx(0);
+		std::atomic<bool> isValid(true);
+		auto verify = [&] {
+			for (auto blockIdx = nextBlockIdx++; blockIdx < checksums.size() && isValid; blockIdx = nextBlockIdx++) {
+				auto offset = blockIdx * blockBytes;
+				auto size = std::min(blockBytes, dataSize - offset);
+				if (checksum(data + offset, size) != checksums[blockIdx]) {
+					isValid = false;
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < threadCount; i++) {
+			threads.emplace_back(verify);
+		}
+		verify();
+		for (auto& thread : threads) thread.join();
+		return isValid;
+	}
+
+	void writePadding(std::fstream& binaryFile, const uint64_t& offset) {
+		static const char zeros[256] = {};
+		auto position = static_cast<uint64_t>(binaryFile.tellp());
+		while (position < offset) {
+			auto size = std::min<uint64_t>(sizeof(zeros), offset - position);
+			binaryFile.write(zeros, size);
+			position += size;
+		}
+	}
+}
 
 const bool PTableFile::exists() {
 	if (filePath.length() <= 0) {
@@ -29,24 +92,51 @@ const bool PTableFile::save(const PTable& pTable) {
 	try {
 		fstream binaryFile(filePath.c_str(), ios::out | ios::binary);
 
-		/* Write the marker */
-		binaryFile.write((char*)&FILE_MARKER, sizeof(FILE_MARKER));
+		auto mnCount = static_cast<uint64_t>(pTable.getMSize() * pTable.getNSize());
+		auto valueSize = PTable::valueSize(pTable.getEncoding());
+		auto dataSize = static_cast<uint64_t>(pTable.getNumStoredVals()) * valueSize;
+		auto blockBytes = CHECKSUM_BLOCK_SIZE * valueSize;
+		auto blockCount = (dataSize + blockBytes - 1) / blockBytes;
+		auto indexData = reinterpret_cast<const char*> (pTable.getIndexArrayPtr());
+		auto data = (pTable.getEncoding() == PTable::Encoding::Log16)
+			? reinterpret_cast<const char*> (pTable.getCodesPtr())
+			: reinterpret_cast<const char*> (pTable.getDataPtr());
 
-		/* Save the sizeof(int) in the current system (this may help to indicate
-		 * the system architecture where the P-value table file is created) */
-		int intSize = sizeof(int);
-		binaryFile.write((char*)&intSize, sizeof(int));
+		Header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+		header.version = FORMAT_VERSION;
+		header.byteOrderMark = BYTE_ORDER_MARK;
+		header.valueEncoding = static_cast<uint32_t>(pTable.getEncoding());
+		header.valueSize = static_cast<uint32_t>(valueSize);
+		header.mSize = pTable.getMSize();
+		header.nSize = pTable.getNSize();
+		header.kSize = pTable.getKSize();
+		header.numStoredVals = pTable.getNumStoredVals();
+		header.indexOffset = alignUp(sizeof(Header), sizeof(uint64_t));
+		header.checksumOffset = alignUp(header.indexOffset + mnCount * sizeof(int64_t), sizeof(uint64_t));
+		header.dataOffset = alignUp(header.checksumOffset + blockCount * sizeof(uint64_t), DATA_ALIGNMENT);
+		header.checksumBlockSize = CHECKSUM_BLOCK_SIZE;
+		header.indexChecksum = checksum(indexData, mnCount * sizeof(int64_t));
+		header.headerChecksum = checksum(reinterpret_cast<const char*> (&header), offsetof(Header, headerChecksum));
 
-		int mSize = pTable.getMSize();
-		int nSize = pTable.getNSize();
-		int kSize = pTable.getKSize();
-		binaryFile.write(reinterpret_cast<char*> (&mSize), sizeof(int));
-		binaryFile.write(reinterpret_cast<char*> (&nSize), sizeof(int));
-		binaryFile.write(reinterpret_cast<char*> (&kSize), sizeof(int));
+		std::vector<uint64_t> checksums(blockCount);
+		for (uint64_t blockIdx = 0; blockIdx < blockCount; blockIdx++) {
+			auto offset = blockIdx * blockBytes;
+			checksums[blockIdx] = checksum(data + offset, std::min(blockBytes, dataSize - offset));
+		}
 
-		float* dataPtr = pTable.getDataPtr();
-		binaryFile.write(reinterpret_cast<char*> (dataPtr), pTable.getNumStoredVals() * sizeof(float));
+		binaryFile.write(reinterpret_cast<const char*> (&header), sizeof(header));
+		writePadding(binaryFile, header.indexOffset);
+		binaryFile.write(indexData, mnCount * sizeof(int64_t));
+		writePadding(binaryFile, header.checksumOffset);
+		binaryFile.write(reinterpret_cast<const char*> (checksums.data()), blockCount * sizeof(uint64_t));
+		writePadding(binaryFile, header.dataOffset);
+		binaryFile.write(data, dataSize);
 
+		if (!binaryFile) {
+			return false;
+		}
 		binaryFile.close();
 		return true;
 
@@ -57,24 +147,143 @@ const bool PTableFile::save(const PTable& pTable) {
 }
 
 const PTableFile::ReadResult PTableFile::tryLoadInto(PTable& pTable) {
-	int mSize, nSize, kSize, memNeeded;
-
 	fstream binaryFile(filePath.c_str(), ios::in | ios::binary);
 	if (!binaryFile.is_open() || binaryFile.fail() || binaryFile.eof()) {
 		return INVALID_FILE;
 	}
 
+	char marker[sizeof(FILE_MARKER)] = {};
+	static_assert(sizeof(FILE_MARKER) == sizeof(FILE_MAGIC), "Both formats begin with a marker of the same size");
+	binaryFile.read(marker, sizeof(marker));
+	if (!binaryFile) {
+		return INVALID_FILE;
+	}
+
+	if (memcmp(marker, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0) {
+		return tryLoadVersion2(binaryFile, pTable);
+	}
+	if (memcmp(marker, FILE_MARKER, sizeof(FILE_MARKER)) == 0) {
+		return tryLoadLegacy(binaryFile, pTable);
+	}
+	return INVALID_FILE;
+}
+
+void PTableFile::showLoading(const long& mSize, const long& nSize, const long& kSize) const {
+	char lineBreak = ' ';
+	if (filePath.length() > 40) lineBreak = '\n';
+
+	App::instance()
+		<< "Loading P-value table from file" << lineBreak
+		<< "\"" << filePath << "\"\n"
+		<< App::DEFAULT_INDENT << "Table size : "
+		<< mSize << " * " << nSize << " * " << kSize << endl;
+	App::instance().showLog(true);
+}
+
+PTableFile::ReadResult PTableFile::tryLoadVersion2(std::fstream& binaryFile, PTable& pTable) {
+	Header header;
+	memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+	binaryFile.read(reinterpret_cast<char*> (&header) + sizeof(header.magic), sizeof(header) - sizeof(header.magic));
+	if (!binaryFile) {
+		return FILE_CORRUPT;
+	}
+
+	if (header.byteOrderMark != BYTE_ORDER_MARK) {
+		return WRONG_ARCH;
+	}
+	if (header.version != FORMAT_VERSION) {
+		return WRONG_VERSION;
+	}
+	if (header.headerChecksum != checksum(reinterpret_cast<const char*> (&header), offsetof(Header, headerChecksum))) {
+		return FILE_CORRUPT;
+	}
+	if (header.valueEncoding != static_cast<uint32_t>(PTable::Encoding::Float32)
+		&& header.valueEncoding != static_cast<uint32_t>(PTable::Encoding::Log16)) {
+		return WRONG_VERSION;
+	}
+	auto encoding = static_cast<PTable::Encoding>(header.valueEncoding);
+	auto valueSize = PTable::valueSize(encoding);
+	if (header.valueSize != valueSize
+		|| header.mSize <= 0 || header.nSize <= 0 || header.kSize <= 0 || header.numStoredVals <= 0
+		|| header.checksumBlockSize == 0
+		|| header.indexOffset % sizeof(int64_t) != 0 || header.dataOffset % valueSize != 0) {
+		return FILE_CORRUPT;
+	}
+
+	showLoading(header.mSize, header.nSize, header.kSize);
+
+	auto mnCount = static_cast<uint64_t>(header.mSize * header.nSize);
+	auto dataSize = static_cast<uint64_t>(header.numStoredVals) * valueSize;
+	auto blockBytes = header.checksumBlockSize * valueSize;
+	std::vector<uint64_t> checksums((dataSize + blockBytes - 1) / blockBytes);
+	binaryFile.seekg(header.checksumOffset);
+	binaryFile.read(reinterpret_cast<char*> (checksums.data()), checksums.size() * sizeof(uint64_t));
+	if (!binaryFile) {
+		return FILE_CORRUPT;
+	}
+
+	auto threadCount = PTable::workerThreadCount();
+	auto loading = UserSettings::instance().pTableLoading;
+	if (loading != UserSettings::PTableLoading::Read) {
+		auto mappedFile = std::make_unique<MappedFile>();
+		if (mappedFile->open(filePath, loading == UserSettings::PTableLoading::MapPrefetch)) {
+			binaryFile.close();
+			if (mappedFile->size() < header.dataOffset + dataSize
+				|| mappedFile->size() < header.indexOffset + mnCount * sizeof(int64_t)
+				|| checksum(mappedFile->data() + header.indexOffset, mnCount * sizeof(int64_t)) != header.indexChecksum) {
+				return FILE_CORRUPT;
+			}
+
+			auto data = mappedFile->data() + header.dataOffset;
+			if (!pTable.initializeMapped(header.mSize, header.nSize, header.kSize, std::move(mappedFile),
+				header.dataOffset, header.indexOffset, encoding)
+				|| pTable.getNumStoredVals() != header.numStoredVals) {
+				return FILE_CORRUPT;
+			}
+
+			// The values are checked while they are used, only the pages of the file are read
+			if (UserSettings::instance().verifyPTable) {
+				pTable.verifyInBackground([data, dataSize, checksums, blockBytes, threadCount] {
+					return verifyBlocks(data, dataSize, checksums, blockBytes, threadCount);
+					});
+			}
+			return SUCCESS;
+		}
+	}
+
 	try {
-		char* marker = new char[sizeof(FILE_MARKER)];
-		binaryFile.read(marker, sizeof(FILE_MARKER));
-		std::string strMarker(marker);
-		std::string strFileMarker(FILE_MARKER);
-		delete marker;
+		// The index array is rebuilt and checked against the stored one, the values are checked once they are read
+		pTable.initialize(header.mSize, header.nSize, header.kSize, encoding);
+		if (pTable.getNumStoredVals() != header.numStoredVals
+			|| checksum(reinterpret_cast<const char*> (pTable.getIndexArrayPtr()), mnCount * sizeof(int64_t)) != header.indexChecksum) {
+			return FILE_CORRUPT;
+		}
 
-		if (strMarker.compare(strFileMarker) != 0)
-			return INVALID_FILE;
+		auto dataPtr = (encoding == PTable::Encoding::Log16)
+			? reinterpret_cast<char*> (pTable.getWritableCodesPtr())
+			: reinterpret_cast<char*> (pTable.getWritableDataPtr());
+		binaryFile.seekg(header.dataOffset);
+		binaryFile.read(dataPtr, dataSize);
+		if (!binaryFile) {
+			return FILE_CORRUPT;
+		}
+		binaryFile.close();
 
+		if (UserSettings::instance().verifyPTable && !verifyBlocks(dataPtr, dataSize, checksums, blockBytes, threadCount)) {
+			return FILE_CORRUPT;
+		}
+	}
+	catch (...) {
+		return FILE_CORRUPT;
+	}
+
+	return SUCCESS;
+}
+
+PTableFile::ReadResult PTableFile::tryLoadLegacy(std::fstream& binaryFile, PTable& pTable) {
+	int mSize, nSize, kSize;
 
+	try {
 		int intSize;
 		binaryFile.read((char*)&intSize, sizeof(int));
 		if (intSize != sizeof(int))
@@ -84,28 +293,34 @@ const PTableFile::ReadResult PTableFile::tryLoadInto(PTable& pTable) {
 		binaryFile.read((char*)&mSize, sizeof(int));
 		binaryFile.read((char*)&nSize, sizeof(int));
 		binaryFile.read((char*)&kSize, sizeof(int));
+		if (!binaryFile)
+			return INVALID_FILE;
 
-		char lineBreak = ' ';
-		if (filePath.length() > 40) lineBreak = '\n';
-
-
-		App::instance()
-			<< "Loading P-value table from file" << lineBreak
-			<< "\"" << filePath << "\"\n"
-			<< App::DEFAULT_INDENT << "Table size : "
-			<< mSize << " * " << nSize << " * " << kSize << endl;
-		App::instance().showLog(true);
-
-
+		showLoading(mSize, nSize, kSize);
 	}
 	catch (...) {
 		return INVALID_FILE;
 	}
 
+	auto loading = UserSettings::instance().pTableLoading;
+	if (loading != UserSettings::PTableLoading::Read) {
+		// The values follow the header, so the file is mapped as it is. It is read if it cannot be mapped
+		size_t dataOffset = static_cast<size_t>(binaryFile.tellg());
+		auto mappedFile = std::make_unique<MappedFile>();
+		if (dataOffset % alignof(float) == 0
+			&& mappedFile->open(filePath, loading == UserSettings::PTableLoading::MapPrefetch)) {
+			binaryFile.close();
+			if (!pTable.initializeMapped(mSize, nSize, kSize, std::move(mappedFile), dataOffset)) {
+				return FILE_CORRUPT;
+			}
+			return SUCCESS;
+		}
+	}
+
 	try {
 
 		pTable.initialize(mSize, nSize, kSize);
-		float* dataPtr = pTable.getDataPtr();
+		float* dataPtr = pTable.getWritableDataPtr();
 		binaryFile.read(reinterpret_cast<char*> (dataPtr),
 			pTable.getNumStoredVals() * sizeof(float));
 
@@ -3,6 +3,8 @@
 #define PTABLEFILE_H
 
 #include <cassert>
+#include <cstdint>
+#include <fstream>
 #include <string>
 #include "PTable.h"
 
@@ -12,6 +14,7 @@ public:
     enum ReadResult {
         INVALID_FILE /** The file is invalid or does not exist. */,
         WRONG_ARCH /** The P-value table file cannot be used on the current system architecture. */,
+        WRONG_VERSION /** The P-value table file was written in a newer format or encoding. */,
         CANCELLED /** The reading process is cancelled by the user. */,
         FILE_CORRUPT /** The file is corrupt. */,
         SUCCESS /** The P-value table has been loaded into RAM successfully. */
@@ -29,19 +32,66 @@ public:
     }
 
     const bool exists();
+
+    // Save the table in the current format
     const bool save(const PTable& pTable);
 
+    // Load a table in the current or the legacy format
     const ReadResult tryLoadInto(PTable& pTable);
     static ReadResult Load(PTable& pTable);
 
 private:
 
     /**
-     * This string will be written at the beginning of every P-value table files.
+     * This string will be written at the beginning of every legacy P-value table files.
      * It is helpful to test if a binary file is a P-value table quickly.
+     * The marker is followed by sizeof(int), the three sizes as int and the values.
      */
     static const char FILE_MARKER[];
 
+    /**
+     * This string begins the P-value table files since the version 2, which are laid out as:
+     * the header, the index array, the checksums of the blocks of values, and the values
+     * from an offset aligned to the page size.
+     */
+    static const char FILE_MAGIC[];
+
+    static constexpr uint32_t FORMAT_VERSION = 2;
+
+    // Written in the native byte order, it reads differently on a machine of another order
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    // A multiple of the page size of all the usual systems
+    static constexpr uint64_t DATA_ALIGNMENT = 1 << 16;
+
+    // The number of values checked by a checksum, whatever their encoding
+    static constexpr uint64_t CHECKSUM_BLOCK_SIZE = 1 << 20;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        // A PTable::Encoding, and the size in bytes of a stored value
+        uint32_t valueEncoding;
+        uint32_t valueSize;
+        int64_t mSize;
+        int64_t nSize;
+        int64_t kSize;
+        int64_t numStoredVals;
+        uint64_t indexOffset;
+        uint64_t checksumOffset;
+        uint64_t dataOffset;
+        uint64_t checksumBlockSize;
+        uint64_t indexChecksum;
+        // The checksum of all the fields above
+        uint64_t headerChecksum;
+    };
+
+    ReadResult tryLoadLegacy(std::fstream& binaryFile, PTable& pTable);
+    ReadResult tryLoadVersion2(std::fstream& binaryFile, PTable& pTable);
+
+    void showLoading(const long& mSize, const long& nSize, const long& kSize) const;
+
     PTableFile(const PTableFile& orig) : filePath(orig.filePath) {
         assert(false); // should never reach here
     }
@@ -24,6 +24,21 @@ void UserSettings::readSettings(std::string& path) {
 	sequencesToReadLimitEnabled = jsonSettings["sequencesToReadLimitEnabled"];
 	sequencesToReadLimit = jsonSettings["sequencesToReadLimit"];
 	pTableFilePath = jsonSettings["pTableFilePath"];
+	std::string loading = jsonSettings.value("pTableLoading", "map");
+	if (loading == "read") pTableLoading = PTableLoading::Read;
+	else if (loading == "mapPrefetch") pTableLoading = PTableLoading::MapPrefetch;
+	else if (loading == "map") pTableLoading = PTableLoading::Map;
+	else std::cerr << "Unknown P-table loading " << loading << ", map is used" << std::endl;
+	verifyPTable = jsonSettings.value("verifyPTable", verifyPTable);
+	std::string encoding = jsonSettings.value("pTableEncoding", "float32");
+	if (encoding == "log16") pTableEncoding = PTableEncoding::Log16;
+	else if (encoding == "float32") pTableEncoding = PTableEncoding::Float32;
+	else std::cerr << "Unknown P-table encoding " << encoding << ", float32 is used" << std::endl;
+	pTableThreadsCount = jsonSettings.value("pTableThreadsCount", pTableThreadsCount);
+	pTableAutoSize = jsonSettings.value("pTableAutoSize", pTableAutoSize);
+	pTableCacheDirectory = jsonSettings.value("pTableCacheDirectory", pTableCacheDirectory);
+	pTableAutoSizeSample = jsonSettings.value("pTableAutoSizeSample", pTableAutoSizeSample);
+	pTableAutoSizeLimit = jsonSettings.value("pTableAutoSizeLimit", pTableAutoSizeLimit);
 	minLongRecombinationThreshold = jsonSettings["minLongRecombinationThreshold"];
 	rejectThreshold = jsonSettings["rejectThreshold"];
 	useAllSites = jsonSettings["useAllSites"];
@@ -38,6 +53,43 @@ void UserSettings::readSettings(std::string& path) {
 	calculateAllBreakpoints = jsonSettings["calculateAllBreakpoints"];
 	calculateNoBreakpoints = jsonSettings["calculateNoBreakpoints"];
 
+	std::string storage = jsonSettings.value("tripletStorage", "auto");
+	if (storage == "best") tripletStorage = TripletStorage::Best;
+	else if (storage == "all") tripletStorage = TripletStorage::All;
+	else if (storage == "topK") tripletStorage = TripletStorage::TopK;
+	else if (storage == "summary") tripletStorage = TripletStorage::Summary;
+	else {
+		if (storage != "auto") std::cerr << "Unknown triplet storage " << storage << ", auto is used" << std::endl;
+		tripletStorage = calculateAllBreakpoints ? TripletStorage::All : TripletStorage::Best;
+	}
+	tripletMemoryLimitMB = jsonSettings.value("tripletMemoryLimitMB", tripletMemoryLimitMB);
+	spillDirectoryPath = jsonSettings.value("spillDirectoryPath", "_");
+	if (spillDirectoryPath == "_") spillDirectoryPath = "";
+	topTripletsPerChild = jsonSettings.value("topTripletsPerChild", topTripletsPerChild);
+	if (topTripletsPerChild == 0) {
+		std::cerr << "topTripletsPerChild must be positive, 1 is used" << std::endl;
+		topTripletsPerChild = 1;
+	}
+
+	std::string engine = jsonSettings.value("detectionEngine", "pairIndex");
+	if (engine == "bitSliced") detectionEngine = DetectionEngine::BitSliced;
+	else if (engine == "dense") detectionEngine = DetectionEngine::Dense;
+	else if (engine == "pairIndex") detectionEngine = DetectionEngine::PairIndex;
+	else std::cerr << "Unknown detection engine " << engine << ", pairIndex is used" << std::endl;
+	simdLevel = jsonSettings.value("simdLevel", simdLevel);
+
+	std::string correction = jsonSettings.value("correctionMethod", "dunnSidak");
+	if (correction == "bonferroni") correctionMethod = CorrectionMethod::Bonferroni;
+	else if (correction == "dunnSidak") correctionMethod = CorrectionMethod::DunnSidak;
+	else std::cerr << "Unknown correction method " << correction << ", dunnSidak is used" << std::endl;
+
+	pValHistogramBinsPerDecade = jsonSettings.value("pValHistogramBinsPerDecade", pValHistogramBinsPerDecade);
+	if (pValHistogramBinsPerDecade == 0) {
+		std::cerr << "pValHistogramBinsPerDecade must be positive, 1 is used" << std::endl;
+		pValHistogramBinsPerDecade = 1;
+	}
+	pValHistogramSampling = jsonSettings.value("pValHistogramSampling", pValHistogramSampling);
+
 	file.close();
 }
 
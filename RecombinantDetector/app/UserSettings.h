@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <filesystem>
 
@@ -31,6 +32,33 @@ public:
 	size_t sequencesToReadLimit = 100;
 
 	std::string pTableFilePath = "";
+	/* How the P-value table is loaded: read into memory, or mapped so that concurrent runs share
+	one copy in the page cache (map, or mapPrefetch to read the whole file into the cache at once) */
+	enum class PTableLoading {
+		Read,
+		Map,
+		MapPrefetch
+	};
+	PTableLoading pTableLoading = PTableLoading::Map;
+	// Check the values of a P-value table against the checksums of its file, a mapped table is checked in the background
+	bool verifyPTable = true;
+	/* How the P-values of a generated or converted table are stored: as 32-bit floats, or as
+	16-bit log-domain codes taking half the memory (see PTable::LOG16_FRACTION_BITS) */
+	enum class PTableEncoding : uint32_t {
+		Float32 = 0,
+		Log16 = 1
+	};
+	PTableEncoding pTableEncoding = PTableEncoding::Float32;
+	/* Size the P-value table to the triplets instead of loading pTableFilePath: the largest m, n and k
+	of the triplets (of a sample of pTableAutoSizeSample of them on larger alignments), up to
+	pTableAutoSizeLimit, are found, and the smallest table covering them is taken from
+	pTableCacheDirectory, or generated and stored there */
+	bool pTableAutoSize = false;
+	std::string pTableCacheDirectory = "ptable_cache";
+	size_t pTableAutoSizeSample = 1000000;
+	size_t pTableAutoSizeLimit = 700;
+	// The threads generating or checking a P-value table, 0 for all the hardware threads
+	size_t pTableThreadsCount = 0;
 	size_t minLongRecombinationThreshold = 100;
 	double rejectThreshold = 0.05;
 
@@ -54,6 +82,51 @@ public:
 	bool calculateAllBreakpoints = false;
 	bool calculateNoBreakpoints = false;
 
+	/* The engine computing the random walks of the triplets:
+	pairIndex visits the sites where the parents differ, bitSliced runs 64 mums at once per word,
+	dense scans all the active columns with SIMD instructions */
+	enum class DetectionEngine {
+		PairIndex,
+		BitSliced,
+		Dense
+	};
+	DetectionEngine detectionEngine = DetectionEngine::PairIndex;
+
+	// The correction for multiple comparisons used to reject the triplets: dunnSidak or bonferroni
+	enum class CorrectionMethod {
+		DunnSidak,
+		Bonferroni
+	};
+	CorrectionMethod correctionMethod = CorrectionMethod::DunnSidak;
+
+	/* The recombinant triplets kept for every child: best, all, topK (the topTripletsPerChild best ones)
+	or summary (the number of recombinant triplets and the best one). auto is all if calculateAllBreakpoints
+	is set, otherwise best */
+	enum class TripletStorage {
+		Best,
+		All,
+		TopK,
+		Summary
+	};
+	TripletStorage tripletStorage = TripletStorage::Best;
+	size_t topTripletsPerChild = 5;
+
+	/* The memory (in MB) the triplets of the all storage may take before they are spilled to sorted
+	runs in spillDirectoryPath (the system temporary directory if empty), 0 for no limit */
+	size_t tripletMemoryLimitMB = 0;
+	std::string spillDirectoryPath = "";
+
+	// The instruction set of the dense engine: auto, avx512, avx2, sse4.2 or scalar
+	std::string simdLevel = "auto";
+
+	// The resolution of the histogram of P-values: the number of bins every decade of p is split into
+	size_t pValHistogramBinsPerDecade = 1;
+	/* The triplets below the critical k of their (m, n) are not significant, so their p-values are
+	needed by the histogram only: 1 in pValHistogramSampling of them gets its p-value and counts that
+	many times in the histogram. 1 for the full histogram, which turns the gate off: no triplet is
+	rejected before its p-value is looked up. 0 for no histogram */
+	size_t pValHistogramSampling = 1;
+
 	// Const parameters
 	// Default file names
 	std::string DefaultLogFileName = "RecDetector.log";
@@ -62,8 +135,8 @@ public:
 	std::string DefaultPvalHistogramFileName = "pvalHist.log";
 	std::string DefaultSkippedTripletsFileName = "skippedTriplets.log";
 
-	// The size of the histogram of P-values
-	const int PvalHistogramSize = 41; // 0 to 40
+	// The decades of p covered by the histogram of P-values, smaller p-values share the last bin
+	const size_t PvalHistogramDecades = 40;
 
 	// The rate (in seconds) at which the progress counter is updated.
 	const long UpdateMonitorInSec = 2;
@@ -0,0 +1,54 @@
+#include "PTableConverter.h"
+
+#include <filesystem>
+
+PTableConverter::PTableConverter(int argc, char** argv) : Run(argc, argv) {
+    App::instance().startProgram("Convert P-Value Table");
+}
+
+void PTableConverter::parseCmdLine() {
+    if (getRunArgsNum() < 2) {
+        App::instance() << "Not enough parameter to convert P-value table.\n";
+        App::instance().showError(true, true);
+    }
+
+    sourceFilePath = m_argVector[2];
+    targetFilePath = m_argVector[3];
+
+    // The source is mapped while the target is written
+    std::error_code error;
+    if (std::filesystem::equivalent(sourceFilePath, targetFilePath, error)) {
+        App::instance() << "The converted P-value table must be stored into another file.\n";
+        App::instance().showError(true, true);
+    }
+
+    TextFile testFile(targetFilePath);
+    if (testFile.exists()) {
+        testFile.removeFile();
+    }
+}
+
+void PTableConverter::perform() {
+    PTableFile sourceFile(sourceFilePath);
+    loadPTable(&sourceFile);
+
+    if (!PTable::instance().waitForVerification()) {
+        App::instance()
+                << "Converting fail! The P-value table file \"" << sourceFilePath << "\" is corrupt.\n";
+        App::instance().showError(true, true);
+    }
+
+    // The table is stored in the encoding of the settings
+    PTable::instance().encode(UserSettings::instance().pTableEncoding);
+
+    if (PTable::instance().saveToFile(targetFilePath)) {
+        App::instance()
+                << "The converted P-value table has been stored into file: \"" << targetFilePath << "\".\n";
+        App::instance().showLog(true);
+    } else {
+        App::instance()
+                << "The converted P-value table cannot be stored into file: \"" << targetFilePath << "\".\n"
+                << "An error occurred during saving progress.\n";
+        App::instance().showError(true, true);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef PTableConverter_H
+#define	PTableConverter_H
+
+#include <cassert>
+#include "Run.h"
+
+/**
+ * Rewrite a P-value table file in the current format, e.g. a legacy file so that it can be
+ * mapped with its index array and checked against its checksums.
+ */
+class PTableConverter : public Run {
+public:
+    PTableConverter(const PTableConverter& orig) = delete;
+
+    PTableConverter& operator=(const PTableConverter& rhs) = delete;
+
+    explicit PTableConverter(int argc, char** argv);
+
+    ~PTableConverter() override = default;
+
+    bool isLogFileSupported() const override {
+        return false;
+    };
+
+    Mode getMode() const override {
+        return Mode::ConvertPTable;
+    };
+
+    void parseCmdLine() override;
+
+    void perform() override;
+
+
+private:
+    string sourceFilePath;
+
+    string targetFilePath;
+};
+
+#endif	/* PTableConverter_H */
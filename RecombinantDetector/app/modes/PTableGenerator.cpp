@@ -11,10 +11,17 @@ void PTableGenerator::parseCmdLine() {
     }
 
     pTableFilePath = m_argVector[2];
-    pTableSize = 0;
-    pTableSize = atoi(m_argVector[3].c_str());
+    pTableMSize = atoi(m_argVector[3].c_str());
+    pTableNSize = pTableMSize;
+    pTableKSize = pTableMSize;
+    // Either a single size for the three, or all of them
+    bool isSizeCountValid = getRunArgsNum() == 2 || getRunArgsNum() == 4;
+    if (getRunArgsNum() == 4) {
+        pTableNSize = atoi(m_argVector[4].c_str());
+        pTableKSize = atoi(m_argVector[5].c_str());
+    }
 
-    if (pTableSize < 2) {
+    if (!isSizeCountValid || pTableMSize < 2 || pTableNSize < 2 || pTableKSize < 2) {
         App::instance() << "Invalid table size.\n";
         App::instance().showError(true, true);
     }
@@ -26,7 +33,8 @@ void PTableGenerator::parseCmdLine() {
 }
 
 void PTableGenerator::perform() {
-    PTable::instance().generateTable(pTableSize, pTableSize, pTableSize);
+    PTable::instance().generateTable(pTableMSize, pTableNSize, pTableKSize);
+    PTable::instance().encode(UserSettings::instance().pTableEncoding);
 
     if (PTable::instance().saveToFile(pTableFilePath)) {
         App::instance()
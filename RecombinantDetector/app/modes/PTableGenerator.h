@@ -30,7 +30,10 @@ public:
 private:
     string pTableFilePath;
     
-    int pTableSize;
+    // The sizes of m, n and k, all the same unless the three are given
+    int pTableMSize;
+    int pTableNSize;
+    int pTableKSize;
 };
 
 #endif	/* PTableGenerator_H */
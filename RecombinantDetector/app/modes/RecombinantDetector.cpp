@@ -1,18 +1,51 @@
 #include "RecombinantDetector.h"
 
-#include <numeric> 
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <random>
+#include <type_traits>
 
+#include "../PTableCache.h"
 #include "../UserSettings.h"
+#include "../../core/ParentPairIndex.h"
+#include "../../core/SimdKernel.h"
 #include "../../utils/ThreadPool.h"
 #include "../../utils/numeric_types.h"
 
+namespace {
+	/* The relative margin above the largest significant p-value of the critical k, far wider than
+	 * the rounding of the corrections for any realistic number of triplets */
+	const long double CRITICAL_PVAL_MARGIN = 1e-3L;
+
+	/* The sampled sizes of the P-value table are widened by 1 / PTABLE_SIZE_MARGIN of themselves */
+	const long PTABLE_SIZE_MARGIN = 4;
+
+	const uint64_t PTABLE_SIZE_SAMPLE_SEED = 0x5EED;
+
+	TripletPool::StorageMode toStorageMode(const UserSettings::TripletStorage& storage) {
+		switch (storage) {
+		case UserSettings::TripletStorage::All:
+			return TripletPool::StorageMode::AllTriplets;
+		case UserSettings::TripletStorage::TopK:
+			return TripletPool::StorageMode::TopK;
+		case UserSettings::TripletStorage::Summary:
+			return TripletPool::StorageMode::SummaryOnly;
+		default:
+			return TripletPool::StorageMode::BestTriplet;
+		}
+	}
+}
+
 RecombinantDetector::RecombinantDetector(int argc, char** argv)
 	: Run(argc, argv),
-	m_tripletPool(), m_alignmentDescriptor(this->m_alignment) {
+	m_tripletPool(), m_alignmentDescriptor(this->m_alignment),
+	m_correction(StatisticalUtils::Correction::of<StatisticalUtils::DunnSidakCorrection>()) {
 	App::instance().startProgram("Full Run");
 
 	m_fileSkippedTriplets = nullptr;
 	m_fileLongRecombinants = nullptr;
+	m_threadCount = 1;
 }
 
 RecombinantDetector::~RecombinantDetector() {
@@ -116,13 +149,38 @@ void RecombinantDetector::perform() {
 
 	dataInfo();
 	setup();
-	loadPTable(m_pTableFile);
+	if (UserSettings::instance().pTableAutoSize) {
+		loadAutoSizedPTable();
+	}
+	else {
+		loadPTable(m_pTableFile);
+	}
 
 	App::instance() << App::SEPARATOR << endl;
 	App::instance().showLog(true);
 
 	analyze();
-	m_tripletPool.writeToFile(m_fileRecombinants);
+
+	// A mapped table is checked while the triplets are analyzed
+	if (!PTable::instance().waitForVerification()) {
+		// The skipped triplets were written during the analysis, they cannot be trusted either
+		if (m_fileSkippedTriplets) {
+			m_fileSkippedTriplets->close();
+			m_fileSkippedTriplets->removeFile();
+		}
+		m_tripletPool.discardSpilledRuns();
+		App::instance()
+			<< "The P-value table file is corrupt, the p-values cannot be trusted.\n";
+		App::instance().showError(true, true);
+	}
+	if (m_tripletPool.isSpilled()) {
+		// The spilled triplets are read back by batches, whose breakpoints are searched in parallel
+		ThreadPool pool(m_threadCount);
+		m_tripletPool.writeToFile(m_fileRecombinants, [this, &pool] { searchBreakPoints(pool); });
+	}
+	else {
+		m_tripletPool.writeToFile(m_fileRecombinants);
+	}
 
 	App::instance() << App::SEPARATOR << endl;
 	App::instance().showLog(true);
@@ -130,7 +188,9 @@ void RecombinantDetector::perform() {
 	displayResult();
 	App::instance() << App::SEPARATOR << endl;
 	App::instance().showLog(true);
-	savePValHistogram('\t');
+	if (UserSettings::instance().pValHistogramSampling != 0) {
+		savePValHistogram('\t');
+	}
 
 	/* Close all files */
 	if (m_fileSkippedTriplets)
@@ -152,6 +212,21 @@ void RecombinantDetector::dataInfo() {
 
 void RecombinantDetector::setup() {
 	Triplet::setAcceptApproxPVal(true);
+
+	if (UserSettings::instance().detectionEngine == UserSettings::DetectionEngine::Dense) {
+		SimdKernel::Level level;
+		if (!SimdKernel::levelFromName(UserSettings::instance().simdLevel, level)) {
+			App::instance() << "Unknown SIMD level \"" << UserSettings::instance().simdLevel << "\", the detected one is used.\n";
+			level = SimdKernel::detectLevel();
+		}
+		else if (!SimdKernel::isSupported(level)) {
+			App::instance() << "The CPU does not support " << SimdKernel::levelName(level) << ", the detected level is used.\n";
+			level = SimdKernel::detectLevel();
+		}
+		SimdKernel::selectLevel(level);
+		App::instance() << "Dense engine uses " << SimdKernel::levelName(level) << " instructions.\n";
+		App::instance().showLog(true);
+	}
 	Triplet::setLongRecombinantThreshold(UserSettings::instance().minLongRecombinationThreshold);
 
 	this->m_numTripletsForStatCorrection = m_alignmentDescriptor.getTripletCounts()->all;
@@ -162,12 +237,8 @@ void RecombinantDetector::setup() {
 		<< " to survive multiple comparisons correction.\n";
 	App::instance().showLog(true);
 
-	if (UserSettings::instance().calculateAllBreakpoints) {
-		m_tripletPool.setStorageMode(TripletPool::StorageMode::AllTriplets);
-	}
-	else {
-		m_tripletPool.setStorageMode(TripletPool::StorageMode::BestTriplet);
-	}
+	m_tripletPool.setStorageMode(toStorageMode(UserSettings::instance().tripletStorage));
+	m_tripletPool.setTopTripletCount(UserSettings::instance().topTripletsPerChild);
 
 	/* Prepare file names */
 	const auto& settings = UserSettings::instance();
@@ -223,35 +294,27 @@ void RecombinantDetector::setup() {
 	}
 }
 
-void RecombinantDetector::showProgress(double currentLoop, bool isFinish, std::vector<size_t>& numsRecombinantTriplets, std::vector<double>& minPvals, std::vector<size_t>& numsSkippedbyHeader) const {
+void RecombinantDetector::showProgress(double currentLoop, bool isFinish, const DetectionStats& stats) const {
 	char strBuf[200];
 
 	if (UserSettings::instance().calculateAllBreakpoints) {
 		sprintf(strBuf,
 			"     %s       %e       %10.0llu            %lu",
 			App::instance().getElapsedTime().c_str(),
-			m_minPVal, m_numRecombinantTriplets,
+			stats.minPval, stats.numRecombinantTriplets,
 			m_tripletPool.getLongestMinRecLength());
 	}
 	else if (m_tryToGetDataFromSequenceName) {
-		size_t totalRecombinants = 0;
-		size_t totalSkippedByHeader = 0;
-		for (size_t tripletsCount : numsRecombinantTriplets) totalRecombinants += tripletsCount;
-		for (size_t tripletsCount : numsSkippedbyHeader) totalSkippedByHeader += tripletsCount;
-
 		sprintf(strBuf,
 			"     %s       %e       %10.0llu            %lu",
 			App::instance().getElapsedTime().c_str(),
-			*std::min_element(minPvals.begin(), minPvals.end()), totalRecombinants, totalSkippedByHeader);
+			stats.minPval, stats.numRecombinantTriplets, stats.numTripletsSkippedByTime);
 	}
 	else {
-		size_t totalRecombinants = 0;
-		for (size_t tripletsCount : numsRecombinantTriplets) totalRecombinants += tripletsCount;
-
 		sprintf(strBuf,
 			"     %s       %e       %10.0llu",
 			App::instance().getElapsedTime().c_str(),
-			*std::min_element(minPvals.begin(), minPvals.end()), totalRecombinants);
+			stats.minPval, stats.numRecombinantTriplets);
 	}
 	App::instance() << strBuf;
 
@@ -263,6 +326,106 @@ void RecombinantDetector::showProgress(double currentLoop, bool isFinish, std::v
 	}
 }
 
+void RecombinantDetector::findPTableSizes(long& mSize, long& nSize, long& kSize) const {
+	auto childSequences = m_alignment.getActiveChildren();
+	auto parentSequences = m_alignment.getActiveParents();
+	auto sampleSize = UserSettings::instance().pTableAutoSizeSample;
+
+	mSize = 0;
+	nSize = 0;
+	kSize = 0;
+	auto cover = [&](const RandomWalkSummary& summary) {
+		mSize = std::max(mSize, summary.upSteps);
+		nSize = std::max(nSize, summary.downSteps);
+		kSize = std::max(kSize, summary.maxDescent);
+	};
+
+	// Every parent pair and child is a triplet in both orientations
+	auto parentCount = parentSequences.size();
+	auto pairCount = static_cast<long double>(parentCount) * (parentCount - 1) / 2 * childSequences.size();
+	bool isSampled = pairCount > sampleSize;
+	if (!isSampled) {
+		ParentPairIndex pairIndex;
+		for (size_t dadIdx = 0; dadIdx < parentCount; dadIdx++) {
+			for (size_t mumIdx = dadIdx + 1; mumIdx < parentCount; mumIdx++) {
+				const auto& dad = parentSequences[dadIdx];
+				const auto& mum = parentSequences[mumIdx];
+				pairIndex.build(dad->bitPlanes(), mum->bitPlanes());
+				for (const auto& child : childSequences) {
+					if (child != dad && child != mum) {
+						auto summary = TripletKernel::computeMirroredSteps(child->bitPlanes(), pairIndex);
+						cover(summary.forward());
+						cover(summary.mirrored());
+					}
+				}
+			}
+		}
+	}
+	else {
+		std::mt19937_64 random(PTABLE_SIZE_SAMPLE_SEED);
+		std::uniform_int_distribution<size_t> childDistribution(0, childSequences.size() - 1);
+		std::uniform_int_distribution<size_t> parentDistribution(0, parentCount - 1);
+		for (size_t sampleIdx = 0; sampleIdx < sampleSize; sampleIdx++) {
+			const auto& child = childSequences[childDistribution(random)];
+			const auto& dad = parentSequences[parentDistribution(random)];
+			const auto& mum = parentSequences[parentDistribution(random)];
+			if (dad != mum && child != dad && child != mum) {
+				auto summary = TripletKernel::computeMirroredSteps(child->bitPlanes(), dad->bitPlanes(), mum->bitPlanes());
+				cover(summary.forward());
+				cover(summary.mirrored());
+			}
+		}
+
+		// A walk has at most one step per active site
+		auto maxSteps = static_cast<long>(m_alignment.activeLength());
+		mSize = std::min(mSize + mSize / PTABLE_SIZE_MARGIN, maxSteps);
+		nSize = std::min(nSize + nSize / PTABLE_SIZE_MARGIN, maxSteps);
+		kSize = std::min(kSize + kSize / PTABLE_SIZE_MARGIN, maxSteps);
+	}
+
+	// The larger walks are approximated, the table is at least the smallest one -gen-p makes
+	auto sizeLimit = static_cast<long>(UserSettings::instance().pTableAutoSizeLimit);
+	mSize = std::max(std::min(mSize, sizeLimit), 2L);
+	nSize = std::max(std::min(nSize, sizeLimit), 2L);
+	kSize = std::max(std::min(kSize, sizeLimit), 2L);
+}
+
+void RecombinantDetector::loadAutoSizedPTable() {
+	const auto& settings = UserSettings::instance();
+
+	long mSize, nSize, kSize;
+	findPTableSizes(mSize, nSize, kSize);
+	App::instance()
+		<< "The triplets need a P-value table of " << mSize << " * " << nSize << " * " << kSize << ".\n";
+	App::instance().showLog(true);
+
+	PTableCache cache(settings.pTableCacheDirectory);
+	auto cachedFilePath = cache.findCovering(mSize, nSize, kSize, settings.pTableEncoding);
+	if (!cachedFilePath.empty()) {
+		PTableFile cachedFile(cachedFilePath);
+		loadPTable(&cachedFile);
+		return;
+	}
+
+	App::instance()
+		<< "No P-value table in \"" << settings.pTableCacheDirectory << "\" covers them, a new one is generated.\n";
+	App::instance().showLog(true);
+	PTable::instance().generateTable(mSize, nSize, kSize);
+	PTable::instance().encode(settings.pTableEncoding);
+
+	std::string filePath;
+	if (cache.store(PTable::instance(), filePath)) {
+		App::instance()
+			<< "The new P-value table has been stored into file: \"" << filePath << "\".\n";
+		App::instance().showLog(true);
+	}
+	else {
+		App::instance()
+			<< "The new P-value table cannot be stored into the directory \"" << settings.pTableCacheDirectory << "\".\n";
+		App::instance().showError(true, false); // the table is still used
+	}
+}
+
 void RecombinantDetector::analyze() {
 	if (UserSettings::instance().calculateAllBreakpoints) {
 		App::instance()
@@ -293,159 +456,388 @@ void RecombinantDetector::analyze() {
 	// This flag indicates if the progressing should be stopped
 	bool isStopped = false;
 
-	size_t threadCount = UserSettings::instance().threadsCount;
-	if (threadCount > childSequences.size()) threadCount = childSequences.size();
+	m_threadCount = UserSettings::instance().threadsCount;
+	if (m_threadCount > childSequences.size()) m_threadCount = childSequences.size();
+	size_t threadCount = m_threadCount;
 
-	ThreadPool pool(threadCount + 1);
+	ThreadPool pool(threadCount);
 	std::vector<std::future<void>> tasks;
 
-	// IntermediateThreadsData also manages chunk sizes for multithreading
-	IntermediateThreadsData threadsData(threadCount, childSequences, parentSequences);
-	// Managing task
-	tasks.emplace_back(pool.enqueue([this, &threadsData] {
-		time_t lastTime =
-			time(nullptr) - UserSettings::instance().UpdateMonitorInSec - 1;
-
-		while (true) {
-			time_t currentTime = time(nullptr);
-			if (currentTime - lastTime >= UserSettings::instance().UpdateMonitorInSec) {
-				double outerLoops = std::accumulate(threadsData.performedOuterLoops.begin(), threadsData.performedOuterLoops.end(), 0);
-				showProgress(outerLoops, false, threadsData.numsRecombinantTriplets, threadsData.minPvals, threadsData.numsTripletsSkippedByTime);
-				lastTime = currentTime;
-
-				if (threadsData.processedChunks == threadsData.chunksCount) return;
+	// IntermediateThreadsData also hands out the dads to the workers
+	IntermediateThreadsData threadsData(makeDetectionConfig(), threadCount, childSequences, parentSequences);
+	m_tripletPool.setSequences(m_alignment.getActiveChildren(), m_alignment.getActiveParents());
+	for (size_t childIdx = 0; childIdx < activeChildNum; childIdx++) {
+		const auto& child = childSequences[childIdx];
+		auto usableParents = &threadsData.usableParentMasks[childIdx * threadsData.parentBlockCount];
+		for (size_t parentIdx = 0; parentIdx < activeParentNum; parentIdx++) {
+			const auto& parent = parentSequences[parentIdx];
+			if (parent == child) {
+				continue;
 			}
+			if (threadsData.config.useHeaderDates && child->isOlderThan(*parent)) {
+				threadsData.tooNewParentCounts[childIdx]++;
+				continue;
+			}
+			usableParents[parentIdx / BitPlanes::WORD_BITS] |= uint64_t(1) << (parentIdx % BitPlanes::WORD_BITS);
 		}
-		}));
+	}
+	if (threadsData.config.detectionEngine == UserSettings::DetectionEngine::BitSliced) {
+		threadsData.parentBitmaps.build(parentSequences);
+	}
+	// With the full histogram every triplet gets its p-value, the table would reject none of them.
+	// Left empty, it reports no triplet below its critical k. A walk has at most one step per active site
+	if (threadsData.config.pValHistogramSampling != 1) {
+		threadsData.criticalKTable.build(PTable::instance(), static_cast<long>(m_alignment.activeLength()),
+			static_cast<double>(StatisticalUtils::dunnSidakInverse(threadsData.config.rejectThreshold,
+				threadsData.config.numTripletsForStatCorrection) * (1.0L + CRITICAL_PVAL_MARGIN)));
+	}
 
-	for (int i = 0; i < threadsData.chunksCount; ++i) {
+	// The detection loop is specialised for the run configuration once, here
+	dispatchDetectionPolicy(threadsData.config, [&](auto policy) {
+		typedef decltype(policy) Policy;
+		m_correction = StatisticalUtils::Correction::of<typename Policy::CorrectionType>();
+		m_tripletPool.setCorrection(m_correction);
+		for (size_t i = 0; i < threadsData.threadCount; ++i) {
+			tasks.emplace_back(
+				pool.enqueue([this, i, &threadsData]
+					{
+						this->process<Policy>(threadsData, i);
+					})
+			);
+		}
+		});
+
+	// The progress is shown from this thread, which sleeps until the next update or the end of the workers
+	auto updateInterval = std::chrono::seconds(UserSettings::instance().UpdateMonitorInSec);
+	do {
+		auto stats = threadsData.snapshot();
+		showProgress(static_cast<double>(stats.performedOuterLoops), false, stats);
+	} while (!threadsData.progress.waitFor(updateInterval));
+
+	for (auto&& task : tasks) task.get();
+
+	m_stats = threadsData.snapshot();
+
+	for (size_t i = 0; i < threadCount; i++) {
+		addPValHistogram(threadsData.pValHistograms[i]);
+	}
+
+	bool isSpilled = std::any_of(threadsData.tripletPools.begin(), threadsData.tripletPools.end(),
+		[](const TripletPool& threadPool) { return threadPool.isSpilled(); });
+	if (isSpilled) {
+		// The breakpoints of the spilled triplets are searched while they are written
+		m_tripletPool.adoptSpilledRuns(threadsData.tripletPools);
+	}
+
+	// The results of the threads are merged child by child, the children are split between the threads
+	tasks.clear();
+	for (size_t i = 0; i < threadCount && !isSpilled; ++i) {
 		tasks.emplace_back(
 			pool.enqueue([this, i, &threadsData]
 				{
-					this->process(threadsData, i);
+					for (size_t childIdx = i; childIdx < threadsData.childSequences.size(); childIdx += threadsData.threadCount) {
+						m_tripletPool.mergeChild(childIdx, threadsData.tripletPools);
+					}
 				})
 		);
 	}
-
 	for (auto&& task : tasks) task.get();
 
-	m_numRecombinantTriplets = 0;
-	m_numComputedExactly = 0;
-	m_numApproximated = 0;
-	m_numSkipped = 0;
-	m_numTripletsSkippedByTime = 0;
-
-	for (size_t i = 0; i < threadCount; i++) {
-		m_numSkipped += threadsData.numsSkipped[i];
-		m_numComputedExactly += threadsData.numsComputedExactly[i];
-		m_numApproximated += threadsData.numsApproximated[i];
-		m_numRecombinantTriplets += threadsData.numsRecombinantTriplets[i];
-		m_numTripletsSkippedByTime += threadsData.numsTripletsSkippedByTime[i];
-		for (const auto& [child, seqs] : threadsData.tripletPools[i].savedTriplets) {
-			for (const auto& seq : seqs)
-				m_tripletPool.saveTriplet(child, seq);
+	// A child is processed by several threads, so it is marked only once all the results are merged
+	for (size_t childIdx = 0; childIdx < activeChildNum; childIdx++) {
+		const auto& child = childSequences[childIdx];
+		if (m_tripletPool.hasTriplets(childIdx)
+			&& child->getRecombinantType() == Sequence::RecombinantType::NotRec) {
+			child->setRecombinantType(Sequence::RecombinantType::Short);
 		}
 	}
-	m_minPVal = *std::min_element(threadsData.minPvals.begin(), threadsData.minPvals.end());
 
-	if (!UserSettings::instance().calculateNoBreakpoints)
-		for (const auto& child : childSequences) m_tripletPool.seekBreakPointPairs(child);
+	// The spilled triplets are searched batch by batch while they are written
+	if (!isSpilled) {
+		searchBreakPoints(pool);
+	}
 
 	/* Progressing finished */
-	showProgress(0.0, true, threadsData.numsRecombinantTriplets, threadsData.minPvals, threadsData.numsTripletsSkippedByTime);
+	showProgress(0.0, true, m_stats);
 
 	App::instance().showLog(true);
 }
 
-void RecombinantDetector::process(IntermediateThreadsData& threadData, size_t chunkIdx) {
-	threadData.guard.lock();
-	// TODO: add entry to the technical log file about starting
-	size_t freeContainerId = ULong::NOT_SET;
-	for (size_t i = 0; i < threadData.containerIsLocked.size(); i++) {
-		if (!threadData.containerIsLocked[i]) {
-			threadData.containerIsLocked[i] = true;
-			freeContainerId = i;
-			break;
-		}
-	}
-	// TODO: add entry to the technical log file
-	if (freeContainerId > threadData.threadCount)
-		std::cout << "WARNING: freeContainerId > threadData.threadCount " << freeContainerId;
-	auto i = freeContainerId;
-	threadData.containerIsLocked[i] = true;
-	threadData.guard.unlock();
-
-	size_t chunkSize = threadData.childSequences.size() / threadData.chunksCount;
-	size_t begin = chunkIdx * chunkSize;
-	size_t end = (chunkIdx < threadData.chunksCount - 1) ? ((chunkIdx + 1) * chunkSize - 1) : threadData.childSequences.size();
-
-	for (size_t childIdx = begin; childIdx < end; childIdx++) {
-		const auto& child = threadData.childSequences.at(childIdx);
-
-		for (const auto& dad : threadData.parentSequences) {
-			if (dad == child) {
-				continue;
-			}
-			if (m_tryToGetDataFromSequenceName && child->isOlderThan(*dad)) {
-				threadData.numsTripletsSkippedByTime[i] += threadData.parentSequences.size();
-				continue;
-			}
-			threadData.performedOuterLoops[i] += 1.0;
+void RecombinantDetector::searchBreakPoints(ThreadPool& pool) {
+	if (UserSettings::instance().calculateNoBreakpoints) {
+		return;
+	}
 
-			for (const auto& mum : threadData.parentSequences) {
-				if (mum == dad || mum == child) {
-					continue;
-				}
-				if (m_tryToGetDataFromSequenceName && child->isOlderThan(*mum)) {
-					threadData.numsTripletsSkippedByTime[i] += 1;
-					continue;
-				}
+	// The breakpoints are searched by blocks of triplets, which the threads take in turn
+	auto blockCount = m_tripletPool.prepareBreakPointSearch();
+	std::atomic<size_t> nextBlockIdx(0);
+	std::vector<std::future<void>> tasks;
+	for (size_t i = 0; i < m_threadCount; ++i) {
+		tasks.emplace_back(
+			pool.enqueue([this, blockCount, &nextBlockIdx]
+				{
+					for (auto blockIdx = nextBlockIdx++; blockIdx < blockCount; blockIdx = nextBlockIdx++) {
+						m_tripletPool.seekBreakPointPairs(blockIdx);
+					}
+				})
+		);
+	}
+	for (auto&& task : tasks) task.get();
+	m_tripletPool.finishBreakPointSearch();
+}
 
-				auto triplet = threadData.tripletPools[i].newTriplet(child, dad, mum);
+RecombinantDetector::DetectionConfig RecombinantDetector::makeDetectionConfig() const {
+	const auto& settings = UserSettings::instance();
+
+	DetectionConfig config;
+	config.useHeaderDates = m_tryToGetDataFromSequenceName;
+	config.writeSkippedTriplets = m_fileSkippedTriplets != nullptr;
+	config.storageMode = toStorageMode(settings.tripletStorage);
+	config.topTripletCount = settings.topTripletsPerChild;
+	config.maxRecordsPerThread = 0;
+	if (settings.tripletMemoryLimitMB != 0) {
+		// The budget is shared by the threads that actually run, see analyze()
+		auto threadCount = std::max<size_t>(m_threadCount, 1);
+		config.maxRecordsPerThread = std::max<size_t>(
+			settings.tripletMemoryLimitMB * 1024 * 1024 / sizeof(TripletRecord) / threadCount, 1);
+	}
+	config.spillDirectoryPath = settings.spillDirectoryPath.empty()
+		? std::filesystem::temp_directory_path().string() : settings.spillDirectoryPath;
+	config.correctionMethod = settings.correctionMethod;
+	config.detectionEngine = settings.detectionEngine;
+	config.rejectThreshold = settings.rejectThreshold;
+	config.numTripletsForStatCorrection = m_numTripletsForStatCorrection;
+	config.pValHistogramBinsPerDecade = settings.pValHistogramBinsPerDecade;
+	config.pValHistogramDecades = settings.PvalHistogramDecades;
+	config.pValHistogramSampling = settings.pValHistogramSampling;
+	return config;
+}
 
-				if (!triplet->hasPVal()) {
-					if (m_fileSkippedTriplets) {
-						m_fileSkippedTriplets->writeLine(triplet->info());
+template <class Function>
+void RecombinantDetector::dispatchDetectionPolicy(const DetectionConfig& config, Function&& function) {
+	auto withEngine = [&](auto dates, auto skipped, auto storage, auto correction) {
+		constexpr bool useHeaderDates = decltype(dates)::value;
+		constexpr bool writeSkippedTriplets = decltype(skipped)::value;
+		constexpr auto storageMode = decltype(storage)::value;
+		typedef decltype(correction) Correction;
+		if (config.detectionEngine == UserSettings::DetectionEngine::BitSliced) {
+			function(DetectionPolicy<useHeaderDates, writeSkippedTriplets, storageMode, Correction, UserSettings::DetectionEngine::BitSliced>{});
+		}
+		else if (config.detectionEngine == UserSettings::DetectionEngine::Dense) {
+			function(DetectionPolicy<useHeaderDates, writeSkippedTriplets, storageMode, Correction, UserSettings::DetectionEngine::Dense>{});
+		}
+		else {
+			function(DetectionPolicy<useHeaderDates, writeSkippedTriplets, storageMode, Correction, UserSettings::DetectionEngine::PairIndex>{});
+		}
+	};
+	auto withCorrection = [&](auto dates, auto skipped, auto storage) {
+		if (config.correctionMethod == UserSettings::CorrectionMethod::Bonferroni) {
+			withEngine(dates, skipped, storage, StatisticalUtils::BonferroniCorrection{});
+		}
+		else {
+			withEngine(dates, skipped, storage, StatisticalUtils::DunnSidakCorrection{});
+		}
+	};
+	auto withStorage = [&](auto dates, auto skipped) {
+		if (config.storageMode == TripletPool::StorageMode::AllTriplets) {
+			withCorrection(dates, skipped, std::integral_constant<TripletPool::StorageMode, TripletPool::StorageMode::AllTriplets>{});
+		}
+		else if (config.storageMode == TripletPool::StorageMode::TopK) {
+			withCorrection(dates, skipped, std::integral_constant<TripletPool::StorageMode, TripletPool::StorageMode::TopK>{});
+		}
+		else if (config.storageMode == TripletPool::StorageMode::SummaryOnly) {
+			withCorrection(dates, skipped, std::integral_constant<TripletPool::StorageMode, TripletPool::StorageMode::SummaryOnly>{});
+		}
+		else {
+			withCorrection(dates, skipped, std::integral_constant<TripletPool::StorageMode, TripletPool::StorageMode::BestTriplet>{});
+		}
+	};
+	auto withSkippedLogging = [&](auto dates) {
+		if (config.writeSkippedTriplets) {
+			withStorage(dates, std::true_type{});
+		}
+		else {
+			withStorage(dates, std::false_type{});
+		}
+	};
+	if (config.useHeaderDates) {
+		withSkippedLogging(std::true_type{});
+	}
+	else {
+		withSkippedLogging(std::false_type{});
+	}
+}
+
+template <class Policy>
+void RecombinantDetector::process(IntermediateThreadsData& threadData, size_t workerId) {
+	// TODO: add entry to the technical log file about starting
+	// Every worker owns the result containers of its id
+	auto i = workerId;
+
+	const auto& childSequences = threadData.childSequences;
+	const auto& parentSequences = threadData.parentSequences;
+	size_t childCount = childSequences.size();
+	size_t parentCount = parentSequences.size();
+
+	std::vector<bool> isUsableDad(childCount);
+	constexpr bool isBitSliced = Policy::detectionEngine == UserSettings::DetectionEngine::BitSliced;
+	BitSlicedBatch batch(threadData.parentBitmaps);
+
+	auto& workerStats = threadData.workerStats[i];
+	auto& stats = workerStats.counters;
+
+	size_t firstDadIdx = 0;
+	size_t endDadIdx = 0;
+	while (threadData.takeDads(firstDadIdx, endDadIdx)) {
+		for (size_t dadIdx = firstDadIdx; dadIdx < endDadIdx; dadIdx++) {
+			const auto& dad = parentSequences[dadIdx];
+
+			for (size_t childIdx = 0; childIdx < childCount; childIdx++) {
+				isUsableDad[childIdx] = false;
+				if (!threadData.isUsableParent(childIdx, dadIdx)) {
+					// A dad that is too new skips all the mums, any other dad skips the mums that are too new
+					if (Policy::useHeaderDates && dad != childSequences[childIdx]) {
+						stats.numTripletsSkippedByTime += parentCount;
 					}
-					threadData.numsSkipped[i]++;
 					continue;
 				}
-
-				if (triplet->hasExactPVal()) {
-					threadData.numsComputedExactly[i]++;
-				}
-				else {
-					threadData.numsApproximated[i]++;
+				if (Policy::useHeaderDates) {
+					stats.numTripletsSkippedByTime += threadData.tooNewParentCounts[childIdx];
 				}
+				stats.performedOuterLoops++;
+				isUsableDad[childIdx] = true;
+			}
 
-				double pValue = triplet->getPValue();
-				addPValIntoHistogram(pValue);
-				if (pValue < threadData.minPvals[i]) {
-					threadData.minPvals[i] = pValue;
-				}
+			if constexpr (isBitSliced) {
+				processBitSliced<Policy>(threadData, i, dadIdx, isUsableDad, batch);
+			}
+			else {
+				processParentPairs<Policy>(threadData, i, dadIdx, isUsableDad);
+			}
 
-				auto correctedPVal = StatisticalUtils::dunnSidak(
-					pValue, m_numTripletsForStatCorrection);
-				if (correctedPVal < UserSettings::instance().rejectThreshold) {
-					threadData.numsRecombinantTriplets[i]++;
-					if (child->getRecombinantType() == Sequence::RecombinantType::NotRec) {
-						child->setRecombinantType(
-							Sequence::RecombinantType::Short);
-					}
-					threadData.tripletPools[i].saveTriplet(child, triplet);
+			workerStats.publish();
+		}
+	}
+	// TODO: add entry to the technical log file about finishing
+	workerStats.publish();
+	threadData.progress.finishWorker();
+}
 
-				}
-				else {
-					threadData.tripletPools[i].freeTriplet(triplet);
-				}
+template <class Policy>
+void RecombinantDetector::processParentPairs(IntermediateThreadsData& threadData, size_t containerId,
+	size_t dadIdx, const std::vector<bool>& isUsableDad) {
+	const auto& childSequences = threadData.childSequences;
+	const auto& parentSequences = threadData.parentSequences;
+	const auto& dad = parentSequences[dadIdx];
+	constexpr bool isDense = Policy::detectionEngine == UserSettings::DetectionEngine::Dense;
+
+	ParentPairIndex pairIndex;
+	// Each unordered parent pair is visited once and scored in both orientations for all children
+	for (size_t mumIdx = dadIdx + 1; mumIdx < parentSequences.size(); mumIdx++) {
+		const auto& mum = parentSequences[mumIdx];
+		if constexpr (!isDense) {
+			pairIndex.build(dad->bitPlanes(), mum->bitPlanes());
+		}
+
+		for (size_t childIdx = 0; childIdx < childSequences.size(); childIdx++) {
+			if (!isUsableDad[childIdx] || !threadData.isUsableParent(childIdx, mumIdx)) {
+				continue;
 			}
+			const auto& child = childSequences[childIdx];
+
+			auto summary = isDense
+				? SimdKernel::computeMirroredSteps(child->activeRow().data, dad->activeRow().data,
+					mum->activeRow().data, child->activeRow().paddedLength)
+				: TripletKernel::computeMirroredSteps(child->bitPlanes(), pairIndex);
+			evaluateTriplet<Policy>(threadData, containerId, childIdx, dadIdx, mumIdx, summary.forward());
+			evaluateTriplet<Policy>(threadData, containerId, childIdx, mumIdx, dadIdx, summary.mirrored());
 		}
 	}
-	// TODO: add entry to the technical log file about finishing
-	threadData.guard.lock();
-	threadData.containerIsLocked[i] = false;
-	threadData.processedChunks++;
-	threadData.guard.unlock();
+}
+
+template <class Policy>
+void RecombinantDetector::processBitSliced(IntermediateThreadsData& threadData, size_t containerId,
+	size_t dadIdx, const std::vector<bool>& isUsableDad, BitSlicedBatch& batch) {
+	const auto& childSequences = threadData.childSequences;
+	const auto& parentSequences = threadData.parentSequences;
+	const auto& dad = parentSequences[dadIdx];
+
+	for (size_t childIdx = 0; childIdx < childSequences.size(); childIdx++) {
+		if (!isUsableDad[childIdx]) {
+			continue;
+		}
+		const auto& child = childSequences[childIdx];
+		auto usableParents = threadData.usableParents(childIdx);
+		batch.setPair(*child, *dad);
+
+		// Only the mums following the dad, the mirror covers the others
+		for (size_t blockIdx = (dadIdx + 1) / ParentColumnBitmaps::BLOCK_SIZE; blockIdx < threadData.parentBlockCount; blockIdx++) {
+			auto mums = usableParents[blockIdx] & BitSlicedBatch::lanesAbove(blockIdx, dadIdx);
+			if (mums == 0) {
+				continue;
+			}
+			batch.run(blockIdx);
+
+			while (mums != 0) {
+				auto lane = lowestSetBit(mums);
+				mums &= mums - 1;
+
+				auto mumIdx = blockIdx * ParentColumnBitmaps::BLOCK_SIZE + lane;
+				auto summary = batch.laneSummary(lane);
+				evaluateTriplet<Policy>(threadData, containerId, childIdx, dadIdx, mumIdx, summary.forward());
+				evaluateTriplet<Policy>(threadData, containerId, childIdx, mumIdx, dadIdx, summary.mirrored());
+			}
+		}
+	}
+}
+
+template <class Policy>
+void RecombinantDetector::evaluateTriplet(IntermediateThreadsData& threadData, size_t containerId,
+	size_t childIdx, size_t dadIdx, size_t mumIdx, const RandomWalkSummary& summary) {
+	auto& tripletPool = threadData.tripletPools[containerId];
+	auto& stats = threadData.workerStats[containerId].counters;
+
+	// A triplet below its critical k is not significant, its p-value is only needed by the histogram
+	bool isBelowCriticalK = threadData.criticalKTable.isBelowCriticalK(summary);
+	if (isBelowCriticalK && !threadData.isHistogramSample(childIdx, dadIdx, mumIdx)) {
+		stats.numBelowCriticalK++;
+		return;
+	}
+
+	auto record = TripletRecord::evaluate(childIdx, dadIdx, mumIdx, summary);
+
+	if (!record.hasPVal()) {
+		if (Policy::writeSkippedTriplets) {
+			auto triplet = tripletPool.newTriplet(record);
+			m_fileSkippedTriplets->writeLine(triplet->info());
+			tripletPool.freeTriplet(triplet);
+		}
+		stats.numSkipped++;
+		return;
+	}
+
+	if (record.isApproximate) {
+		stats.numApproximated++;
+	}
+	else {
+		stats.numComputedExactly++;
+	}
+
+	double pValue = record.pValue;
+	threadData.pValHistograms[containerId].add(pValue, isBelowCriticalK ? threadData.config.pValHistogramSampling : 1);
+	if (pValue < stats.minPval) {
+		stats.minPval = pValue;
+	}
+	if (isBelowCriticalK) {
+		return;
+	}
+
+	auto correctedPVal = Policy::CorrectionType::correct(
+		pValue, threadData.config.numTripletsForStatCorrection);
+	if (correctedPVal < threadData.config.rejectThreshold) {
+		stats.numRecombinantTriplets++;
+		tripletPool.template saveTriplet<Policy::storageMode>(record);
+	}
 }
 
 void RecombinantDetector::displayResult() {
@@ -467,14 +859,19 @@ void RecombinantDetector::displayResult() {
 	App::instance()
 		<< "Number of triples tested :              "
 		<< m_alignmentDescriptor.getTripletCounts()->active << "\n"
-		<< "Number of p-values computed exactly :   " << m_numComputedExactly
+		<< "Number of p-values computed exactly :   " << m_stats.numComputedExactly
 		<< "\n"
-		<< "Number of p-values approximated (HS) :  " << m_numApproximated
+		<< "Number of p-values approximated (HS) :  " << m_stats.numApproximated
 		<< "\n"
-		<< "Number of p-values not computed :       " << m_numSkipped << "\n"
+		<< "Number of p-values not computed :       " << m_stats.numSkipped << "\n";
+	if (m_stats.numBelowCriticalK != 0) {
+		App::instance()
+			<< "Number of triplets below critical k :    " << m_stats.numBelowCriticalK << "\n";
+	}
+	App::instance()
 		<< endl
 		<< "Number of recombinant triplets :                               \t"
-		<< m_numRecombinantTriplets << "\n"
+		<< m_stats.numRecombinantTriplets << "\n"
 		<< "Number of distinct recombinant sequences :                     \t"
 		<< numRecombinant << "\n";
 
@@ -490,27 +887,44 @@ void RecombinantDetector::displayResult() {
 	if (m_tryToGetDataFromSequenceName) {
 		App::instance()
 			<< "Number of skipped triplets due to discrepancies between the dates of the parent and the child:    "
-			<< m_numTripletsSkippedByTime;
+			<< m_stats.numTripletsSkippedByTime;
 	}
 	App::instance().showOutput(true);
 
 	App::instance() << App::SEPARATOR << endl;
 	App::instance().showLog(true);
 
+	// Without a histogram, the triplets below their critical k get no p-value. Unless one of the
+	// triplets is significant, the minimum over the others is not the minimum of the run
+	bool isMinPValComputed = m_stats.numComputedExactly + m_stats.numApproximated != 0
+		&& !(m_stats.numRecombinantTriplets == 0 && m_stats.numBelowCriticalK != 0
+			&& UserSettings::instance().pValHistogramSampling == 0);
+	if (!isMinPValComputed) {
+		App::instance()
+			<< "The minimum p-value was not computed, none of the triplets is significant.\n";
+		App::instance().showOutput(true);
+		return;
+	}
+
 	char formatedPVal[20];
 	sprintf(formatedPVal,
 		"%1.3e",
-		static_cast<double> (StatisticalUtils::dunnSidak(m_minPVal)));
+		static_cast<double> (m_correction.correct(m_stats.minPval, 0)));
 	App::instance()
 		<< "Rejection of the null hypothesis of clonal evolution at p = "
-		<< StatisticalUtils::dunnSidak(m_minPVal)
+		<< m_correction.correct(m_stats.minPval, 0)
 		<< "\n"
 		<< "                                                        p = "
 		<< formatedPVal << "\n"
 		<< "                                            Uncorrected p = "
-		<< m_minPVal << "\n"
+		<< m_stats.minPval << "\n"
 		<< "                                            Bonferroni  p = "
-		<< StatisticalUtils::bonferroni(m_minPVal)
+		<< StatisticalUtils::bonferroni(m_stats.minPval)
 		<< "\n";
+	if (m_stats.numRecombinantTriplets == 0 && m_stats.numBelowCriticalK != 0) {
+		// Otherwise the minimum is a recombinant triplet, whose p-value is always computed
+		App::instance()
+			<< "The minimum p-value is taken over the sampled triplets only, none of the triplets is significant.\n";
+	}
 	App::instance().showOutput(true);
 }
\ No newline at end of file
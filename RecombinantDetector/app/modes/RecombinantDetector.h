@@ -3,14 +3,20 @@
 
 #include <cassert>
 #include <string>
-#include <mutex>
+#include <atomic>
 #include "Run.h"
 #include "../FastaReader.h"
 #include "../PTableFile.h"
 #include "../UserSettings.h"
+#include "../../core/BitSlicedBatch.h"
+#include "../../core/CriticalKTable.h"
 #include "../../core/Triplet.h"
 #include "../../core/TripletPool.h"
 #include "../../core/AlignmentDescriptor.h"
+#include "../../core/DetectionStats.h"
+#include "../../utils/ProgressMonitor.h"
+
+class ThreadPool;
 
 
 class RecombinantDetector : public Run {
@@ -33,57 +39,156 @@ public:
 
 
 private:
+	/**
+	 * The settings of a detection run, copied once before the threads start,
+	 * so the detection loop does not access the settings singleton.
+	 */
+	struct DetectionConfig {
+		bool useHeaderDates;
+		bool writeSkippedTriplets;
+		TripletPool::StorageMode storageMode;
+		size_t topTripletCount;
+		// The triplets one thread keeps in memory in the AllTriplets mode, 0 for no limit
+		size_t maxRecordsPerThread;
+		std::string spillDirectoryPath;
+		UserSettings::CorrectionMethod correctionMethod;
+		UserSettings::DetectionEngine detectionEngine;
+		double rejectThreshold;
+		long double numTripletsForStatCorrection;
+		size_t pValHistogramBinsPerDecade;
+		size_t pValHistogramDecades;
+		size_t pValHistogramSampling;
+	};
+
+	/**
+	 * The options of the detection loop that are resolved at compile time.
+	 * The loop is instantiated for every combination and the right one is picked once per run.
+	 */
+	template <bool DateFiltering, bool SkippedLogging, TripletPool::StorageMode Storage, class Correction,
+		UserSettings::DetectionEngine Engine>
+	struct DetectionPolicy {
+		static constexpr bool useHeaderDates = DateFiltering;
+		static constexpr bool writeSkippedTriplets = SkippedLogging;
+		static constexpr TripletPool::StorageMode storageMode = Storage;
+		typedef Correction CorrectionType;
+		static constexpr UserSettings::DetectionEngine detectionEngine = Engine;
+	};
+
 	struct IntermediateThreadsData {
-		IntermediateThreadsData(size_t iThreadCount, std::vector<SequencePtr>& iChildSequences, std::vector<SequencePtr>& iParentSequences) :threadCount(iThreadCount), numsSkipped(threadCount),
-			numsComputedExactly(threadCount),
-			numsApproximated(threadCount),
-			numsRecombinantTriplets(threadCount),
-			numsTripletsSkippedByTime(threadCount),
-			performedOuterLoops(threadCount),
-			minPvals(threadCount),
+		IntermediateThreadsData(const DetectionConfig& iConfig, size_t iThreadCount, std::vector<SequencePtr>& iChildSequences, std::vector<SequencePtr>& iParentSequences) :config(iConfig), threadCount(iThreadCount),
+			workerStats(threadCount),
 			tripletPools(threadCount),
-			containerIsLocked(threadCount),
+			bestTriplets(iChildSequences.size()),
+			pValHistograms(threadCount, PValueHistogram(config.pValHistogramBinsPerDecade, config.pValHistogramDecades)),
+			progress(threadCount),
+			tooNewParentCounts(iChildSequences.size(), 0),
+			parentBlockCount(BitPlanes::wordCount(iParentSequences.size())),
+			usableParentMasks(iChildSequences.size() * parentBlockCount, 0),
 			childSequences(iChildSequences),
 			parentSequences(iParentSequences) {
 
-			// we can experiment with these values
-			if (iChildSequences.size() > threadCount * 4)
-				chunksCount = threadCount * 4;
-
 			for (size_t i = 0; i < threadCount; i++) {
-				if (UserSettings::instance().calculateAllBreakpoints) {
-					tripletPools[i].setStorageMode(TripletPool::StorageMode::AllTriplets);
+				tripletPools[i].setStorageMode(config.storageMode);
+				tripletPools[i].setSequences(iChildSequences, iParentSequences);
+				tripletPools[i].setTopTripletCount(config.topTripletCount);
+				if (config.storageMode == TripletPool::StorageMode::AllTriplets && config.maxRecordsPerThread != 0) {
+					tripletPools[i].setSpilling(config.spillDirectoryPath, config.maxRecordsPerThread);
 				}
-				else {
-					tripletPools[i].setStorageMode(TripletPool::StorageMode::BestTriplet);
+				if (config.storageMode == TripletPool::StorageMode::BestTriplet
+					|| config.storageMode == TripletPool::StorageMode::SummaryOnly) {
+					tripletPools[i].shareBestTriplets(bestTriplets);
 				}
-
-				minPvals[i] = 1.0;
-				performedOuterLoops[i] = 0.0;
 			}
 		};
 
+		const DetectionConfig config;
+
 		size_t threadCount;
-		size_t chunksCount;
-		size_t processedChunks = 0;
-
-		std::vector<size_t> numsSkipped;
-		std::vector<size_t> numsComputedExactly;
-		std::vector<size_t> numsApproximated;
-		std::vector<size_t> numsRecombinantTriplets;
-		std::vector<size_t> numsTripletsSkippedByTime;
-		std::vector<size_t> performedOuterLoops;
-		std::vector<double> minPvals;
+
+		// The first dad not taken by a worker yet
+		std::atomic<size_t> nextDadIdx{ 0 };
+
+		/**
+		 * Take the next range of dads [first, end) for a worker, false when all the dads are taken.
+		 * Dad d pairs with the mums above it, so the early dads carry the most work: a range is sized to
+		 * a share of the remaining parent pairs, which shrinks the ranges towards the end of the run.
+		 */
+		bool takeDads(size_t& first, size_t& end) {
+			size_t parentCount = parentSequences.size();
+			first = nextDadIdx.load(std::memory_order_relaxed);
+			do {
+				if (first >= parentCount) {
+					return false;
+				}
+				size_t remainingDads = parentCount - first;
+				size_t remainingPairs = remainingDads * (remainingDads - 1) / 2;
+				size_t targetPairs = remainingPairs / (threadCount * GRAINS_PER_THREAD);
+
+				end = first;
+				size_t takenPairs = 0;
+				do {
+					takenPairs += parentCount - 1 - end;
+					end++;
+				} while (end < parentCount && takenPairs < targetPairs);
+			} while (!nextDadIdx.compare_exchange_weak(first, end, std::memory_order_relaxed));
+			return true;
+		}
+
+		// How many ranges each worker takes out of the remaining work, at least
+		static const size_t GRAINS_PER_THREAD = 4;
+
+		// Published by the workers after every dad
+		std::vector<WorkerStats> workerStats;
 		std::vector<TripletPool> tripletPools;
+		// The best triplet of every child found by any of the threads, for the BestTriplet and SummaryOnly modes
+		BestTripletTable bestTriplets;
+		std::vector<PValueHistogram> pValHistograms;
+
+		ProgressMonitor progress;
+
+		// The published counters of all the workers
+		DetectionStats snapshot() const {
+			DetectionStats stats;
+			for (const auto& worker : workerStats) {
+				stats.merge(worker.snapshot());
+			}
+			return stats;
+		}
+
+		// The number of parents sequenced too late to be a parent of each child
+		std::vector<size_t> tooNewParentCounts;
+
+		// For each child, a bit per parent that can be its parent: not the child itself and not too new
+		size_t parentBlockCount;
+		std::vector<uint64_t> usableParentMasks;
+
+		const uint64_t* usableParents(const size_t& childIdx) const {
+			return &usableParentMasks[childIdx * parentBlockCount];
+		}
 
-		// shared resource
-		std::vector<bool> containerIsLocked;
+		bool isUsableParent(const size_t& childIdx, const size_t& parentIdx) const {
+			return (usableParents(childIdx)[parentIdx / BitPlanes::WORD_BITS] >> (parentIdx % BitPlanes::WORD_BITS)) & 1;
+		}
+
+		// Built only for the bit-sliced engine
+		ParentColumnBitmaps parentBitmaps;
+
+		CriticalKTable criticalKTable;
+
+		// If a triplet below its critical k gets its p-value for the histogram, the same whatever the thread
+		bool isHistogramSample(const size_t& childIdx, const size_t& dadIdx, const size_t& mumIdx) const {
+			auto sampling = config.pValHistogramSampling;
+			if (sampling <= 1) {
+				return sampling == 1;
+			}
+			uint64_t hash = childIdx * 0x9E3779B97F4A7C15ULL + dadIdx * 0xC2B2AE3D27D4EB4FULL + mumIdx * 0x165667B19E3779F9ULL;
+			hash = (hash ^ (hash >> 31)) * 0xBF58476D1CE4E5B9ULL;
+			return (hash >> 32) % sampling == 0;
+		}
 
 		std::vector<SequencePtr>& childSequences;
 		std::vector<SequencePtr>& parentSequences;
 
-		std::mutex guard;
-
 	};
 
 	RecombinantDetector(const RecombinantDetector& orig) = delete;
@@ -92,11 +197,45 @@ private:
 
 	void dataInfo();
 	void setup();
+
+	/**
+	 * Find the largest m, n and k of the triplets: of all of them, or of a sample of pTableAutoSizeSample
+	 * widened by a margin, up to pTableAutoSizeLimit. The triplets beyond the sizes are approximated as
+	 * with any table.
+	 */
+	void findPTableSizes(long& mSize, long& nSize, long& kSize) const;
+
+	// Load the smallest cached P-value table covering the triplets, or generate it into the cache
+	void loadAutoSizedPTable();
+
 	void analyze();
-	void showProgress(double currentLoop, bool isFinish, std::vector<size_t>& numsRecombinantTriplets, std::vector<double>& minPvals, std::vector<size_t>& numsSkippedByHeader) const;
+
+	// Search the breakpoints of the saved triplets by blocks, in parallel on the pool
+	void searchBreakPoints(ThreadPool& pool);
+	void showProgress(double currentLoop, bool isFinish, const DetectionStats& stats) const;
 	void displayResult();
 
-	void process(IntermediateThreadsData& threadsData, size_t chunkIdx);
+	DetectionConfig makeDetectionConfig() const;
+
+	// Call function with a default-constructed DetectionPolicy matching the config
+	template <class Function>
+	static void dispatchDetectionPolicy(const DetectionConfig& config, Function&& function);
+
+	template <class Policy>
+	void process(IntermediateThreadsData& threadsData, size_t workerId);
+
+	// Evaluate the triplets of the dad with all the mums following it, in both orientations
+	template <class Policy>
+	void processParentPairs(IntermediateThreadsData& threadData, size_t containerId,
+		size_t dadIdx, const std::vector<bool>& isUsableDad);
+	template <class Policy>
+	void processBitSliced(IntermediateThreadsData& threadData, size_t containerId,
+		size_t dadIdx, const std::vector<bool>& isUsableDad, BitSlicedBatch& batch);
+
+	// Compute the p-value of a single triplet, update the statistics and save it if it is recombinant
+	template <class Policy>
+	void evaluateTriplet(IntermediateThreadsData& threadData, size_t containerId,
+		size_t childIdx, size_t dadIdx, size_t mumIdx, const RandomWalkSummary& summary);
 private:
 	bool m_readFromDir = false;
 	bool m_tryToGetDataFromSequenceName = false;
@@ -107,15 +246,16 @@ private:
 
 	PTableFile* m_pTableFile;
 
-	double m_minPVal;
-
 	size_t m_numTripletsForStatCorrection;
 
-	size_t m_numRecombinantTriplets;
-	size_t m_numComputedExactly;
-	size_t m_numApproximated;
-	size_t m_numSkipped;
-	size_t m_numTripletsSkippedByTime;
+	// The detection threads, no more than the children
+	size_t m_threadCount;
+
+	// The correction of the detection policy, for the results and their summary
+	StatisticalUtils::Correction m_correction;
+
+	// The counters of the last run, merged from all the workers
+	DetectionStats m_stats;
 
 	TextFile* m_fileSkippedTriplets;
 	TextFile* m_fileRecombinants;
@@ -3,6 +3,7 @@
 #include "Run.h"
 
 #include "RecombinantDetector.h"
+#include "PTableConverter.h"
 #include "PTableGenerator.h"
 
 #include "../UserSettings.h"
@@ -11,8 +12,7 @@
 #include "../../core/AlignmentDescriptor.h"
 
 Run::Run(int argc, char** argv)
-	: m_argCount(argc), m_alignment(),
-	m_pValsHistogram(UserSettings::instance().PvalHistogramSize, 0) {
+	: m_argCount(argc), m_alignment() {
 	App::instance().storeCommand(argc, argv);
 
 	m_argVector.reserve(argc);
@@ -34,6 +34,9 @@ Run* Run::getRun(int argc, char** argv) {
 	if (mode == "-gen-p" || mode == "-g") {
 		return new PTableGenerator(argc, argv);
 	}
+	else if (mode == "-convert-p") {
+		return new PTableConverter(argc, argv);
+	}
 	else if (mode == "-detect" || mode == "-d") {
 		return new RecombinantDetector(argc, argv);
 	}
@@ -145,15 +148,8 @@ void Run::perform() {
 	}
 }
 
-void Run::addPValIntoHistogram(double pValue) {
-	int index = static_cast<int> (-1.0 * log10(pValue));
-	if (index >= UserSettings::instance().PvalHistogramSize) {
-		index = UserSettings::instance().PvalHistogramSize - 1;
-	}
-	if (index < 0) {
-		index = 0;
-	}
-	m_pValsHistogram[index]++;
+void Run::addPValHistogram(const PValueHistogram& histogram) {
+	m_pValHistogram.merge(histogram);
 }
 
 void Run::savePValHistogram(const char& separator) {
@@ -170,25 +166,35 @@ void Run::savePValHistogram(const char& separator) {
 		pHistFile.openToWrite();
 
 		char bufStr[200];
-		for (int i = 0; i < UserSettings::instance().PvalHistogramSize; i++) {
-			auto histVal = static_cast<long double> (m_pValsHistogram[i]);
+		sprintf(bufStr,
+			"# %lu bins per decade, bin%cmax p%cmin p%ccount%cper triplet%clog10(per triplet)",
+			m_pValHistogram.binsPerDecade(),
+			separator, separator, separator, separator, separator);
+		pHistFile.writeLine(bufStr);
+
+		for (size_t i = 0; i < m_pValHistogram.binCount(); i++) {
+			auto count = m_pValHistogram.count(i);
 			auto histPerTriplet =
-				(m_pValsHistogram[i] == 0) ? 0.0L : histVal / nActiveTriplets;
+				(count == 0) ? 0.0L : static_cast<long double> (count) / nActiveTriplets;
 
 			if (histPerTriplet != 0.0) {
 				sprintf(bufStr,
-					"%3d%c%20lu%c%1.8Lf%c%1.3Lf",
+					"%5lu%c%1.3e%c%1.3e%c%20lu%c%1.8Lf%c%1.3Lf",
 					i, separator,
-					m_pValsHistogram[i], separator,
+					m_pValHistogram.maxPValue(i), separator,
+					m_pValHistogram.minPValue(i), separator,
+					count, separator,
 					histPerTriplet, separator,
 					log10(histPerTriplet)
 				);
 			}
 			else {
 				sprintf(bufStr,
-					"%3d%c%20lu%c%1.8Lf%cN/A",
+					"%5lu%c%1.3e%c%1.3e%c%20lu%c%1.8Lf%cN/A",
 					i, separator,
-					m_pValsHistogram[i], separator,
+					m_pValHistogram.maxPValue(i), separator,
+					m_pValHistogram.minPValue(i), separator,
+					count, separator,
 					histPerTriplet, separator
 				);
 			}
@@ -228,6 +234,12 @@ void Run::loadPTable(PTableFile* pTableFile) {
 			App::instance().showError(true, true);
 			break;
 
+		case PTableFile::WRONG_VERSION:
+			App::instance()
+				<< "The P-value table file was written by a newer version of the program.\n";
+			App::instance().showError(true, true);
+			break;
+
 		case PTableFile::CANCELLED:
 			App::instance() << "Loading is cancelled.\n";
 			App::instance().showLog(true);
@@ -252,6 +264,7 @@ void Run::loadPTable(PTableFile* pTableFile) {
 		PTableFile::ReadResult readResult = PTableFile::Load(PTable::instance());
 		switch (readResult) {
 		case PTableFile::WRONG_ARCH:    // fall through
+		case PTableFile::WRONG_VERSION: // fall through
 		case PTableFile::INVALID_FILE:
 			App::instance()
 				<< "Cannot find any valid P-value table file.\n";
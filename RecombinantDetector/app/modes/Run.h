@@ -12,13 +12,14 @@
 #include "../PTableFile.h"
 
 #include "../../core/Alignment.h"
+#include "../../utils/PValueHistogram.h"
 #include "../../utils/StringUtils.h"
 
 class Run {
 public:
 
 	enum class Mode {
-		GeneratePTable, RecombinantDetection
+		GeneratePTable, ConvertPTable, RecombinantDetection
 	};
 
 	Run(const Run& orig) = delete;
@@ -48,7 +49,8 @@ protected:
 	virtual void deleteCmdLineArgs(int numDelete);
 
 	virtual int getRunArgsNum() const;
-	virtual void addPValIntoHistogram(double pValue);
+	// Add the p-values counted by a thread
+	virtual void addPValHistogram(const PValueHistogram& histogram);
 	virtual void savePValHistogram(const char& separator);
 	virtual void loadPTable(PTableFile* pTableFile);
 
@@ -59,7 +61,7 @@ protected:
 	std::vector<std::string> m_argVector;
 
 private:
-	std::vector<size_t> m_pValsHistogram;
+	PValueHistogram m_pValHistogram;
 
 	std::string m_pValHistogramFileName;
 
@@ -0,0 +1,20 @@
+#include "ActiveMatrix.h"
+
+#include <algorithm>
+
+ActiveMatrix::ActiveMatrix(const std::vector<SequencePtr>& sequences, const std::vector<size_t>& activePositions)
+	: m_rowCount(sequences.size()), m_rowLength(activePositions.size()) {
+	m_rowStride = std::max<size_t>(1, (m_rowLength + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT) * ROW_ALIGNMENT;
+
+	auto nElements = std::max<size_t>(1, m_rowCount) * m_rowStride;
+	m_data.reset(static_cast<Nucleotide*>(::operator new[](nElements * sizeof(Nucleotide), std::align_val_t(ROW_ALIGNMENT))));
+	std::fill_n(m_data.get(), nElements, Nucleotide::Gap);
+
+	for (size_t rowIdx = 0; rowIdx < m_rowCount; rowIdx++) {
+		const auto& nucleotides = sequences[rowIdx]->nucleotides();
+		auto row = m_data.get() + rowIdx * m_rowStride;
+		for (size_t activeNuIdx = 0; activeNuIdx < m_rowLength; activeNuIdx++) {
+			row[activeNuIdx] = nucleotides[activePositions[activeNuIdx]];
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "Sequence.h"
+#include "SequenceRow.h"
+
+/**
+ * The active columns of the sequences of an alignment in a single contiguous block, one row
+ * per sequence. Every row starts on a 64-byte boundary and is padded with gaps up to the next
+ * one, so the rows can be scanned sequentially by whole SIMD blocks.
+ */
+class ActiveMatrix {
+public:
+	static const size_t ROW_ALIGNMENT = 64;
+
+	ActiveMatrix(const std::vector<SequencePtr>& sequences, const std::vector<size_t>& activePositions);
+
+	ActiveMatrix(const ActiveMatrix& rhs) = delete;
+	ActiveMatrix& operator=(const ActiveMatrix&) = delete;
+
+	size_t rowCount() const { return m_rowCount; };
+	size_t rowLength() const { return m_rowLength; };
+	size_t rowStride() const { return m_rowStride; };
+
+	SequenceRow row(const size_t& rowIdx) const {
+		return SequenceRow{ m_data.get() + rowIdx * m_rowStride, m_rowLength, m_rowStride };
+	};
+
+private:
+	struct AlignedDeleter {
+		void operator()(Nucleotide* data) const {
+			::operator delete[](data, std::align_val_t(ROW_ALIGNMENT));
+		}
+	};
+
+	size_t m_rowCount;
+	size_t m_rowLength;
+	size_t m_rowStride;
+	std::unique_ptr<Nucleotide[], AlignedDeleter> m_data;
+};
@@ -71,6 +71,13 @@ bool Alignment::isChildParentFromSamePool() const {
 }
 
 void Alignment::lock() {
+	if (!this->m_activeMatrix) {
+		this->lockColumns();
+		this->packActiveColumns();
+	}
+}
+
+void Alignment::lockColumns() {
 	if (!this->m_locked) {
 		this->populatePositionVector();
 		this->markAllelicStatuses();
@@ -165,8 +172,12 @@ void Alignment::markAllelicStatuses() {
 }
 
 void Alignment::excludeMonomorphicColumns() {
-	// Make sure the m_alignment has been locked before processing it
-	this->lock();
+	// The matrix is built once, from the polymorphic columns only
+	if (this->m_activeMatrix) {
+		throw std::logic_error(
+			"Monomorphic columns must be excluded before the active columns are packed.");
+	}
+	this->lockColumns();
 
 	// Delete non-polymorphic columns
 	size_t newActiveLen = 0;
@@ -184,6 +195,25 @@ void Alignment::excludeMonomorphicColumns() {
 		throw std::logic_error(
 			"The alignment does not contain any polymorphic columns; analysis halted.");
 	}
+
+	this->packActiveColumns();
+}
+
+void Alignment::packActiveColumns() {
+	std::vector<SequencePtr> sequences(m_parentPool.m_allSequences);
+	if (!m_isSinglePool) {
+		sequences.insert(sequences.end(), m_childPool.m_allSequences.begin(), m_childPool.m_allSequences.end());
+	}
+
+	m_activeMatrix = std::make_shared<ActiveMatrix>(sequences, *m_activeNucPositions);
+	for (size_t rowIdx = 0; rowIdx < sequences.size(); rowIdx++) {
+		const auto& sequence = sequences[rowIdx];
+		sequence->m_activeMatrix = m_activeMatrix;
+		sequence->m_activeRow = m_activeMatrix->row(rowIdx);
+		sequence->m_bitPlanes.build(sequence->m_activeRow);
+		// The rows and the gap mask replace the whole sequence
+		std::vector<Nucleotide>().swap(sequence->m_nucleotides);
+	}
 }
 
 const std::vector<SequencePtr>& Alignment::getActiveParents() const {
@@ -2,6 +2,7 @@
 #include <vector>
 #include <set>
 
+#include "ActiveMatrix.h"
 #include "Sequence.h"
 #include "AllelicMask.h"
 #include "SequencePool.h"
@@ -43,11 +44,15 @@ public:
 
 	/**
 	 * Lock the m_alignment, i.e. forbidding adding more sequences into the m_alignment.
-	 * The locking process also does: [1] populating the active nucleotide-position vector
-	 * and [2] scan and mark the allelic status of each m_alignment column.
+	 * The locking process also does: [1] populating the active nucleotide-position vector,
+	 * [2] scan and mark the allelic status of each m_alignment column and [3] pack all the columns.
 	 */
 	void lock();
 
+	/**
+	 * Lock the m_alignment and pack its polymorphic columns only.
+	 * Must be called instead of lock(), the packed columns are not changed afterwards.
+	 */
 	void excludeMonomorphicColumns();
 
 	const std::vector<SequencePtr>& getActiveParents() const;
@@ -59,10 +64,20 @@ public:
 	std::set<SequencePtr> getAllUsedSequences() const;
 
 private:
+	// Steps [1] and [2] of lock()
+	void lockColumns();
+
 	void populatePositionVector();
 
 	void markAllelicStatuses();
 
+	/**
+	 * Copy the active columns of every sequence into a new ActiveMatrix and pack them into bit
+	 * planes for the triplet kernel. The sequences are pointed to their rows of the matrix and
+	 * release their whole nucleotide vectors, so it is called once the active columns are final.
+	 */
+	void packActiveColumns();
+
 private:
 	/**
 	 * A pointer to the vector that contains active nucleotide-positions.
@@ -70,6 +85,9 @@ private:
 	 */
 	std::shared_ptr<std::vector<size_t>> m_activeNucPositions;
 
+	/** The active columns of all sequences, built by packActiveColumns. */
+	std::shared_ptr<ActiveMatrix> m_activeMatrix;
+
 	/**
 	 * The vector contains pointers to all sequences in this m_alignment,
 	 * including both parent and child sequences.
@@ -0,0 +1,22 @@
+#include "BestTripletTable.h"
+
+#include <limits>
+
+BestTripletTable::BestTripletTable(size_t childCount) : m_bestPValues(childCount) {
+	for (auto& bestPValue : m_bestPValues) {
+		bestPValue.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+	}
+}
+
+bool BestTripletTable::offer(const TripletRecord& record) {
+	// Only a filter, the records themselves are compared after the threads are joined
+	auto& bestPValue = m_bestPValues[record.childIdx];
+	auto current = bestPValue.load(std::memory_order_relaxed);
+	while (record.pValue < current) {
+		if (bestPValue.compare_exchange_weak(current, record.pValue, std::memory_order_relaxed)) {
+			return true;
+		}
+	}
+	// An equal p-value is kept, the tie is broken by the sequence indices
+	return record.pValue == current;
+}
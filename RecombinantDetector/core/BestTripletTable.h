@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+#include "TripletRecord.h"
+
+/**
+ * The p-value of the best recombinant triplet of every active child, shared by all the detection
+ * threads. A thread keeps its best record of every child in a slot of its own, overwritten by the
+ * better ones, and offers a record here before saving it: a record worse than the best one of
+ * another thread is dropped, any other lowers the shared p-value with a compare-and-swap.
+ * The memory does not grow with the improvements, and the best record of a child is picked from
+ * the slots of the threads by TripletRecord::ranksBefore once they are done, so it does not
+ * depend on the scheduling.
+ */
+class BestTripletTable {
+public:
+	explicit BestTripletTable(size_t childCount);
+
+	BestTripletTable(const BestTripletTable&) = delete;
+	BestTripletTable& operator=(const BestTripletTable&) = delete;
+
+	// Lower the best p-value of the child to the one of the record, false if a better one was offered
+	bool offer(const TripletRecord& record);
+
+	// The lowest p-value offered for the child, infinite if none was offered
+	double bestPValue(const size_t& childIdx) const {
+		return m_bestPValues[childIdx].load(std::memory_order_relaxed);
+	};
+
+private:
+	std::vector<std::atomic<double>> m_bestPValues;
+};
@@ -0,0 +1,33 @@
+#include "BitPlanes.h"
+
+void BitPlanes::build(const SequenceRow& row) {
+	length = row.length;
+
+	auto nWords = wordCount(length);
+	lowBits.assign(nWords, 0);
+	highBits.assign(nWords, 0);
+	nonGapMask.assign(nWords, 0);
+
+	for (size_t activeNuIdx = 0; activeNuIdx < length; activeNuIdx++) {
+		auto wordIdx = activeNuIdx / WORD_BITS;
+		auto bit = uint64_t(1) << (activeNuIdx % WORD_BITS);
+
+		switch (row[activeNuIdx]) {
+		case Nucleotide::Adenine:
+			break;
+		case Nucleotide::Cytosine:
+			lowBits[wordIdx] |= bit;
+			break;
+		case Nucleotide::Guanine:
+			highBits[wordIdx] |= bit;
+			break;
+		case Nucleotide::Thymine:
+			lowBits[wordIdx] |= bit;
+			highBits[wordIdx] |= bit;
+			break;
+		case Nucleotide::Gap:
+			continue;
+		}
+		nonGapMask[wordIdx] |= bit;
+	}
+}
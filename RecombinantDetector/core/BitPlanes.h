@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SequenceRow.h"
+
+/**
+ * Bit-packed representation of the active columns of a sequence.
+ * Every nucleotide is encoded by two allele bits (A = 00, C = 01, G = 10, T = 11) stored in
+ * the low and high planes, and a non-gap bit. A gap has both allele bits cleared.
+ * Bits beyond the active length are always zero, so the last word needs no special handling.
+ */
+struct BitPlanes {
+public:
+	static const size_t WORD_BITS = 64;
+
+	std::vector<uint64_t> lowBits;
+	std::vector<uint64_t> highBits;
+	std::vector<uint64_t> nonGapMask;
+
+	size_t length = 0;
+
+	// Pack the active nucleotides of a sequence
+	void build(const SequenceRow& row);
+
+	size_t wordCount() const {
+		return nonGapMask.size();
+	}
+
+	static size_t wordCount(const size_t& nBits) {
+		return (nBits + WORD_BITS - 1) / WORD_BITS;
+	}
+};
+
+inline int popCount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(word);
+#else
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return static_cast<int>((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// The index of the lowest set bit, the word must not be zero
+inline size_t lowestSetBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<size_t>(__builtin_ctzll(word));
+#else
+	return static_cast<size_t>(popCount((word & (~word + 1)) - 1));
+#endif
+}
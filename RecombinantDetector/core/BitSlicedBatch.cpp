@@ -0,0 +1,166 @@
+#include "BitSlicedBatch.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+	// Add one to the lanes of the mask
+	inline void increment(uint64_t* value, const size_t& width, uint64_t lanes) {
+		for (size_t bit = 0; bit < width && lanes != 0; bit++) {
+			auto carry = value[bit] & lanes;
+			value[bit] ^= lanes;
+			lanes = carry;
+		}
+	}
+
+	// Subtract one from the lanes of the mask that are above zero
+	inline void decrementAboveZero(uint64_t* value, const size_t& width, uint64_t lanes) {
+		uint64_t aboveZero = 0;
+		for (size_t bit = 0; bit < width; bit++) {
+			aboveZero |= value[bit];
+		}
+		lanes &= aboveZero;
+		for (size_t bit = 0; bit < width && lanes != 0; bit++) {
+			auto borrow = ~value[bit] & lanes;
+			value[bit] ^= lanes;
+			lanes = borrow;
+		}
+	}
+
+	// maximum = max(maximum, value) on the lanes of the mask
+	inline void raiseMaximum(uint64_t* maximum, const uint64_t* value, const size_t& width, uint64_t lanes) {
+		uint64_t greater = 0;
+		uint64_t equal = ~uint64_t(0);
+		for (size_t bit = width; bit-- > 0;) {
+			greater |= equal & value[bit] & ~maximum[bit];
+			equal &= ~(value[bit] ^ maximum[bit]);
+		}
+		lanes &= greater;
+		if (lanes == 0) {
+			return;
+		}
+		for (size_t bit = 0; bit < width; bit++) {
+			maximum[bit] = (maximum[bit] & ~lanes) | (value[bit] & lanes);
+		}
+	}
+
+	inline long laneValue(const uint64_t* value, const size_t& width, const size_t& lane) {
+		long result = 0;
+		for (size_t bit = 0; bit < width; bit++) {
+			result |= static_cast<long>((value[bit] >> lane) & 1) << bit;
+		}
+		return result;
+	}
+}
+
+void ParentColumnBitmaps::build(const std::vector<SequencePtr>& parents) {
+	m_parentCount = parents.size();
+	m_columnCount = parents.empty() ? 0 : parents.front()->bitPlanes().length;
+	m_bitmaps.assign(blockCount() * m_columnCount * ALLELE_COUNT, 0);
+
+	for (size_t parentIdx = 0; parentIdx < m_parentCount; parentIdx++) {
+		const auto& planes = parents[parentIdx]->bitPlanes();
+		auto laneBit = uint64_t(1) << (parentIdx % BLOCK_SIZE);
+		auto blockBitmaps = &m_bitmaps[(parentIdx / BLOCK_SIZE) * m_columnCount * ALLELE_COUNT];
+
+		for (size_t wordIdx = 0; wordIdx < planes.wordCount(); wordIdx++) {
+			auto sites = planes.nonGapMask[wordIdx];
+			while (sites != 0) {
+				auto bit = lowestSetBit(sites);
+				sites &= sites - 1;
+
+				auto allele = ((planes.lowBits[wordIdx] >> bit) & 1) | (((planes.highBits[wordIdx] >> bit) & 1) << 1);
+				auto columnIdx = wordIdx * BitPlanes::WORD_BITS + bit;
+				blockBitmaps[columnIdx * ALLELE_COUNT + allele] |= laneBit;
+			}
+		}
+	}
+}
+
+BitSlicedBatch::BitSlicedBatch(const ParentColumnBitmaps& parents) : m_parents(parents) {
+	// Every counter is bounded by the number of columns
+	m_width = 1;
+	while (m_width < MAX_COUNTER_WIDTH && (uint64_t(1) << m_width) <= parents.columnCount()) {
+		m_width++;
+	}
+	assert((uint64_t(1) << m_width) > parents.columnCount());
+	std::fill(std::begin(m_counters), std::end(m_counters), 0);
+}
+
+void BitSlicedBatch::setPair(const Sequence& child, const Sequence& dad) {
+	m_pairColumns.clear();
+
+	const auto& childPlanes = child.bitPlanes();
+	const auto& dadPlanes = dad.bitPlanes();
+	for (size_t wordIdx = 0; wordIdx < childPlanes.wordCount(); wordIdx++) {
+		auto sites = childPlanes.nonGapMask[wordIdx] & dadPlanes.nonGapMask[wordIdx];
+		auto dadMatches = ~((childPlanes.lowBits[wordIdx] ^ dadPlanes.lowBits[wordIdx])
+			| (childPlanes.highBits[wordIdx] ^ dadPlanes.highBits[wordIdx]));
+
+		while (sites != 0) {
+			auto bit = lowestSetBit(sites);
+			sites &= sites - 1;
+
+			auto allele = ((childPlanes.lowBits[wordIdx] >> bit) & 1) | (((childPlanes.highBits[wordIdx] >> bit) & 1) << 1);
+			auto columnIdx = wordIdx * BitPlanes::WORD_BITS + bit;
+			m_pairColumns.push_back(static_cast<uint32_t>((columnIdx << 3) | (allele << 1) | ((dadMatches >> bit) & 1)));
+		}
+	}
+}
+
+void BitSlicedBatch::run(const size_t& blockIdx) {
+	for (int counterIdx = 0; counterIdx < CounterCount; counterIdx++) {
+		std::fill_n(counter(static_cast<Counter>(counterIdx)), m_width, 0);
+	}
+
+	auto blockBitmaps = m_parents.block(blockIdx);
+	for (auto pairColumn : m_pairColumns) {
+		auto alleles = blockBitmaps + (pairColumn >> 3) * ParentColumnBitmaps::ALLELE_COUNT;
+		auto childAlleleLanes = alleles[(pairColumn >> 1) & 3];
+
+		if (pairColumn & 1) {
+			// The mums with another nucleotide
+			auto lanes = (alleles[0] | alleles[1] | alleles[2] | alleles[3]) & ~childAlleleLanes;
+			if (lanes != 0) {
+				stepUp(lanes);
+			}
+		}
+		else if (childAlleleLanes != 0) {
+			stepDown(childAlleleLanes);
+		}
+	}
+}
+
+void BitSlicedBatch::stepUp(const uint64_t& lanes) {
+	increment(counter(UpSteps), m_width, lanes);
+	decrementAboveZero(counter(DistanceToMax), m_width, lanes);
+	increment(counter(DistanceToMin), m_width, lanes);
+	raiseMaximum(counter(MaxAscent), counter(DistanceToMin), m_width, lanes);
+}
+
+void BitSlicedBatch::stepDown(const uint64_t& lanes) {
+	increment(counter(DownSteps), m_width, lanes);
+	decrementAboveZero(counter(DistanceToMin), m_width, lanes);
+	increment(counter(DistanceToMax), m_width, lanes);
+	raiseMaximum(counter(MaxDescent), counter(DistanceToMax), m_width, lanes);
+}
+
+MirroredWalkSummary BitSlicedBatch::laneSummary(const size_t& lane) const {
+	return MirroredWalkSummary{
+		laneValue(counter(UpSteps), m_width, lane),
+		laneValue(counter(DownSteps), m_width, lane),
+		laneValue(counter(MaxDescent), m_width, lane),
+		laneValue(counter(MaxAscent), m_width, lane) };
+}
+
+uint64_t BitSlicedBatch::lanesAbove(const size_t& blockIdx, const size_t& parentIdx) {
+	auto firstParent = blockIdx * ParentColumnBitmaps::BLOCK_SIZE;
+	if (parentIdx < firstParent) {
+		return ~uint64_t(0);
+	}
+	auto lane = parentIdx - firstParent;
+	if (lane >= ParentColumnBitmaps::BLOCK_SIZE - 1) {
+		return 0;
+	}
+	return ~uint64_t(0) << (lane + 1);
+}
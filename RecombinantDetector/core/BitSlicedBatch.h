@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "BitPlanes.h"
+#include "Sequence.h"
+#include "TripletKernel.h"
+
+/**
+ * The active columns of the parents transposed: for every block of 64 parents, every active
+ * column and every allele (A, C, G, T) a bitmap with one bit per parent of the block.
+ * A gap sets no bit.
+ */
+class ParentColumnBitmaps {
+public:
+	static const size_t ALLELE_COUNT = 4;
+	static const size_t BLOCK_SIZE = BitPlanes::WORD_BITS;
+
+	void build(const std::vector<SequencePtr>& parents);
+
+	size_t parentCount() const { return m_parentCount; };
+	size_t columnCount() const { return m_columnCount; };
+	size_t blockCount() const { return BitPlanes::wordCount(m_parentCount); };
+
+	// The allele bitmaps of all the columns of a block, ALLELE_COUNT words per column
+	const uint64_t* block(const size_t& blockIdx) const {
+		return &m_bitmaps[blockIdx * m_columnCount * ALLELE_COUNT];
+	};
+
+private:
+	std::vector<uint64_t> m_bitmaps;
+	size_t m_parentCount = 0;
+	size_t m_columnCount = 0;
+};
+
+/**
+ * Evaluates one (child, dad) against a block of 64 mums at once.
+ * The walks of the block are kept as bit-sliced counters: bit b of every lane of a counter is
+ * stored in the word b, so a step of any subset of the mums costs a few word operations.
+ * Besides m and n, the engine tracks the distance to the running maximum and minimum of the
+ * walk, which gives k of the triplet and of its mirror (child, mum, dad).
+ */
+class BitSlicedBatch {
+public:
+	static const size_t MAX_COUNTER_WIDTH = 32;
+
+	explicit BitSlicedBatch(const ParentColumnBitmaps& parents);
+
+	/**
+	 * Collect the columns where both the child and the dad have a nucleotide.
+	 * Must be called before the blocks of the pair are run.
+	 */
+	void setPair(const Sequence& child, const Sequence& dad);
+
+	/**
+	 * Run the walks of the current (child, dad) for all the mums of the block.
+	 * Lanes out of the parent list are computed too and should be masked by the caller.
+	 */
+	void run(const size_t& blockIdx);
+
+	// The summary of (child, dad, mum) and its mirror for the mum in the given lane of the last block
+	MirroredWalkSummary laneSummary(const size_t& lane) const;
+
+	// The lanes of the block holding the parents with an index greater than parentIdx
+	static uint64_t lanesAbove(const size_t& blockIdx, const size_t& parentIdx);
+
+private:
+	enum Counter {
+		UpSteps,
+		DownSteps,
+		DistanceToMax,
+		MaxDescent,
+		DistanceToMin,
+		MaxAscent,
+		CounterCount
+	};
+
+	uint64_t* counter(Counter counter) {
+		return &m_counters[counter * MAX_COUNTER_WIDTH];
+	};
+
+	const uint64_t* counter(Counter counter) const {
+		return &m_counters[counter * MAX_COUNTER_WIDTH];
+	};
+
+	void stepUp(const uint64_t& lanes);
+	void stepDown(const uint64_t& lanes);
+
+	const ParentColumnBitmaps& m_parents;
+	size_t m_width;
+
+	// (column << 3) | (child allele << 1) | (1 if the dad matches the child)
+	std::vector<uint32_t> m_pairColumns;
+
+	uint64_t m_counters[CounterCount * MAX_COUNTER_WIDTH];
+};
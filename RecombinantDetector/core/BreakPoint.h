@@ -1,45 +1,30 @@
 #pragma once
+#include <cstdint>
 #include <string>
-#include <sstream>
-#include <memory>
+#include <vector>
 
+/**
+ * The range of original positions where a recombination may have happened, and the height of
+ * the random walk there. Stored by value in the vectors of its triplet.
+ */
 struct BreakPoint {
-	size_t leftBound;
-	size_t rightBound;
+	uint32_t leftBound;
+	uint32_t rightBound;
 	long long height;
-
-	explicit BreakPoint(const size_t& leftBound,
-		const size_t& rightBound,
-		const long long& height)
-		: leftBound(leftBound), rightBound(rightBound), height(height) {};
-
-	static std::shared_ptr<BreakPoint> create(const size_t& leftBound,
-		const size_t& rightBound,
-		const long long& height) {
-		return std::make_shared<BreakPoint>(leftBound, rightBound, height);
-	};
-
 };
 
-typedef std::shared_ptr<BreakPoint> BreakPointPtr;
-
+// A left and a right breakpoint, as indices in the breakpoint vectors of their triplet
 struct BreakPointPair {
-public:
-	BreakPointPtr leftBreakPoint;
-	BreakPointPtr rightBreakPoint;
-
-	explicit BreakPointPair(BreakPointPtr leftBreakPoint,
-		BreakPointPtr rightBreakPoint)
-		: leftBreakPoint(std::move(leftBreakPoint)),
-		rightBreakPoint(std::move(rightBreakPoint)) {};
-
-	std::string toString() const {
-		std::stringstream strStream;
-		strStream << leftBreakPoint->leftBound << "-"
-			<< leftBreakPoint->rightBound << " & "
-			<< rightBreakPoint->leftBound << "-"
-			<< rightBreakPoint->rightBound;
-		return strStream.str();
+	uint32_t leftIdx;
+	uint32_t rightIdx;
+
+	std::string toString(const std::vector<BreakPoint>& leftBreakPoints,
+		const std::vector<BreakPoint>& rightBreakPoints) const {
+		const auto& leftBreakPoint = leftBreakPoints[leftIdx];
+		const auto& rightBreakPoint = rightBreakPoints[rightIdx];
+		return std::to_string(leftBreakPoint.leftBound) + "-"
+			+ std::to_string(leftBreakPoint.rightBound) + " & "
+			+ std::to_string(rightBreakPoint.leftBound) + "-"
+			+ std::to_string(rightBreakPoint.rightBound);
 	}
 };
-
@@ -0,0 +1,38 @@
+#include "CriticalKTable.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "../app/PTable.h"
+
+void CriticalKTable::build(const PTable& pTable, const long& maxSteps, const double& maxSignificantPVal) {
+	m_criticalK.clear();
+	m_maxM = -1;
+	m_maxN = -1;
+
+	// The trivial p-values of 1 below the stored k must not be significant
+	if (maxSignificantPVal > 1.0 || pTable.getNumStoredVals() == 0) {
+		return;
+	}
+
+	m_maxM = std::min(pTable.getMSize(), maxSteps);
+	m_maxN = std::min(pTable.getNSize(), maxSteps);
+	m_criticalK.assign((m_maxM + 1) * (m_maxN + 1), 0);
+
+	// A smaller critical k only gates fewer triplets, so the ones too large for the cells are clamped
+	const long maxCriticalK = std::numeric_limits<uint16_t>::max();
+
+	for (long m = 1; m <= m_maxM; m++) {
+		for (long n = 1; n <= m_maxN; n++) {
+			// The p-value is 1 below minK, and the stored values of (m, n) go up to maxK
+			auto minK = (n - m + 1 > 2) ? n - m + 1 : 2;
+			auto maxK = (n < pTable.getKSize()) ? n : pTable.getKSize();
+
+			auto criticalK = minK;
+			while (criticalK <= maxK && pTable.getExactPValue(m, n, criticalK) >= maxSignificantPVal) {
+				criticalK++;
+			}
+			m_criticalK[m * (m_maxN + 1) + n] = static_cast<uint16_t>(std::min(criticalK, maxCriticalK));
+		}
+	}
+}
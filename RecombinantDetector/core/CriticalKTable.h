@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "TripletKernel.h"
+
+class PTable;
+
+/**
+ * For every (m, n) covered by the P-value table, the smallest k whose p-value is below the
+ * largest p-value that can survive the correction for multiple comparisons. A triplet with a
+ * smaller k is not significant, so it is rejected with a single compare, before its p-value is
+ * looked up and corrected. The triplets at or above the critical k are decided as before.
+ */
+class CriticalKTable {
+public:
+	/**
+	 * @param maxSteps The most steps of a walk, the cells above it are not built
+	 * @param maxSignificantPVal No p-value at or above it survives the correction
+	 */
+	void build(const PTable& pTable, const long& maxSteps, const double& maxSignificantPVal);
+
+	bool isBelowCriticalK(const RandomWalkSummary& summary) const {
+		if (summary.upSteps > m_maxM || summary.downSteps > m_maxN) {
+			return false;
+		}
+		return summary.maxDescent < m_criticalK[summary.upSteps * (m_maxN + 1) + summary.downSteps];
+	};
+
+	bool isEmpty() const { return m_criticalK.empty(); };
+
+private:
+	long m_maxM = -1;
+	long m_maxN = -1;
+
+	// The critical k of (m, n) at m * (m_maxN + 1) + n, 0 for the cells that are not gated
+	std::vector<uint16_t> m_criticalK;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+static const size_t CACHE_LINE_SIZE = 64;
+
+// The counters of a detection run, or of a part of it
+struct DetectionStats {
+	size_t numSkipped = 0;
+	size_t numComputedExactly = 0;
+	size_t numApproximated = 0;
+	// The triplets rejected by their critical k whose p-value was not computed
+	size_t numBelowCriticalK = 0;
+	size_t numRecombinantTriplets = 0;
+	size_t numTripletsSkippedByTime = 0;
+	size_t performedOuterLoops = 0;
+	double minPval = 1.0;
+
+	void merge(const DetectionStats& other) {
+		numSkipped += other.numSkipped;
+		numComputedExactly += other.numComputedExactly;
+		numApproximated += other.numApproximated;
+		numBelowCriticalK += other.numBelowCriticalK;
+		numRecombinantTriplets += other.numRecombinantTriplets;
+		numTripletsSkippedByTime += other.numTripletsSkippedByTime;
+		performedOuterLoops += other.performedOuterLoops;
+		if (other.minPval < minPval) {
+			minPval = other.minPval;
+		}
+	}
+};
+
+/**
+ * The counters of one detection worker, on cache lines of its own.
+ * The worker updates its counters without synchronisation and publishes a copy from time to
+ * time, other threads only read the published copy. Every published field is a relaxed atomic:
+ * a snapshot taken during the run may mix two publishes, which is fine for the progress, and
+ * the one taken after the worker is joined is exact.
+ */
+class alignas(CACHE_LINE_SIZE) WorkerStats {
+public:
+	// Owned by the worker
+	DetectionStats counters;
+
+	void publish() {
+		m_numSkipped.store(counters.numSkipped, std::memory_order_relaxed);
+		m_numComputedExactly.store(counters.numComputedExactly, std::memory_order_relaxed);
+		m_numApproximated.store(counters.numApproximated, std::memory_order_relaxed);
+		m_numBelowCriticalK.store(counters.numBelowCriticalK, std::memory_order_relaxed);
+		m_numRecombinantTriplets.store(counters.numRecombinantTriplets, std::memory_order_relaxed);
+		m_numTripletsSkippedByTime.store(counters.numTripletsSkippedByTime, std::memory_order_relaxed);
+		m_performedOuterLoops.store(counters.performedOuterLoops, std::memory_order_relaxed);
+		m_minPval.store(counters.minPval, std::memory_order_relaxed);
+	}
+
+	// The counters at the last publish()
+	DetectionStats snapshot() const {
+		DetectionStats published;
+		published.numSkipped = m_numSkipped.load(std::memory_order_relaxed);
+		published.numComputedExactly = m_numComputedExactly.load(std::memory_order_relaxed);
+		published.numApproximated = m_numApproximated.load(std::memory_order_relaxed);
+		published.numBelowCriticalK = m_numBelowCriticalK.load(std::memory_order_relaxed);
+		published.numRecombinantTriplets = m_numRecombinantTriplets.load(std::memory_order_relaxed);
+		published.numTripletsSkippedByTime = m_numTripletsSkippedByTime.load(std::memory_order_relaxed);
+		published.performedOuterLoops = m_performedOuterLoops.load(std::memory_order_relaxed);
+		published.minPval = m_minPval.load(std::memory_order_relaxed);
+		return published;
+	}
+
+private:
+	std::atomic<size_t> m_numSkipped{ 0 };
+	std::atomic<size_t> m_numComputedExactly{ 0 };
+	std::atomic<size_t> m_numApproximated{ 0 };
+	std::atomic<size_t> m_numBelowCriticalK{ 0 };
+	std::atomic<size_t> m_numRecombinantTriplets{ 0 };
+	std::atomic<size_t> m_numTripletsSkippedByTime{ 0 };
+	std::atomic<size_t> m_performedOuterLoops{ 0 };
+	std::atomic<double> m_minPval{ 1.0 };
+};
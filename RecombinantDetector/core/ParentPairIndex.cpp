@@ -0,0 +1,20 @@
+#include "ParentPairIndex.h"
+
+void ParentPairIndex::build(const BitPlanes& dad, const BitPlanes& mum) {
+	words.clear();
+	siteCount = 0;
+
+	auto nWords = dad.wordCount();
+	for (size_t wordIdx = 0; wordIdx < nWords; wordIdx++) {
+		auto siteMask = dad.nonGapMask[wordIdx] & mum.nonGapMask[wordIdx]
+			& ((dad.lowBits[wordIdx] ^ mum.lowBits[wordIdx]) | (dad.highBits[wordIdx] ^ mum.highBits[wordIdx]));
+		if (siteMask == 0) {
+			continue;
+		}
+
+		words.push_back(InformativeWord{ static_cast<uint32_t>(wordIdx), siteMask,
+			dad.lowBits[wordIdx], dad.highBits[wordIdx],
+			mum.lowBits[wordIdx], mum.highBits[wordIdx] });
+		siteCount += popCount(siteMask);
+	}
+}
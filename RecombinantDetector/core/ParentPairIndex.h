@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "BitPlanes.h"
+
+/**
+ * The informative sites of a parent pair: active columns where the dad and the mum carry
+ * different nucleotides and neither of them has a gap. Only these columns can move the
+ * random walk of a triplet, whatever the child is.
+ * The sites are kept sorted and grouped by the words of the bit planes, together with the
+ * alleles of both parents, so the index is built once per pair and reused for all children.
+ */
+struct ParentPairIndex {
+public:
+	struct InformativeWord {
+		uint32_t wordIdx;
+		uint64_t siteMask;
+
+		uint64_t dadLowBits;
+		uint64_t dadHighBits;
+		uint64_t mumLowBits;
+		uint64_t mumHighBits;
+	};
+
+	std::vector<InformativeWord> words;
+
+	// The number of informative sites, i.e. the distance between the parents
+	size_t siteCount = 0;
+
+	void build(const BitPlanes& dad, const BitPlanes& mum);
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <cassert>
 #include <fstream> 
 #include <iostream> 
 #include <cstring>
@@ -92,6 +93,8 @@ void PhyloTree::computeMutationIndexes() {
 void PhyloTree::computeMutationIndexes(spPhyloNode node) {
 	const auto& nucs = node->sequence()->nucleotides();
 	const auto& rootNucs = m_root->sequence()->nucleotides();
+	// Empty once the alignment has packed the active columns
+	assert(!nucs.empty() && !rootNucs.empty());
 	if (nucs.size() != rootNucs.size()) {
 		std::cout << "ERROR: DIFFERENT NUCLEOTIDES LENGHT. " << nucs.size() << " vs " << rootNucs.size() << "\n";
 		return;
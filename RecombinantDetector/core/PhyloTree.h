@@ -6,6 +6,11 @@
 #include "Sequence.h"
 
 namespace fs = std::filesystem;
+
+/**
+ * The tree compares the whole sequences, so it must be built before an alignment packs their
+ * active columns and releases the whole sequences (see Alignment::lock()).
+ */
 class PhyloTree
 {
 public:
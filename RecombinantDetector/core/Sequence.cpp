@@ -1,8 +1,10 @@
 #include "Sequence.h"
 
+#include <algorithm>
 #include <utility>
 #include <stdexcept>
 
+#include "ActiveMatrix.h"
 #include "../utils/StringUtils.h"
 #include "../app/UserSettings.h"
 
@@ -40,9 +42,17 @@ Sequence::Sequence(std::string name, const std::string& dna)
 	m_recombinantType(RecombinantType::NotRec) {
 
 	auto processedDna = preprocessInput(dna);
-	for (auto nuc : processedDna) {
-		this->m_nucleotides.push_back(Nucleotide(nuc));
+	m_fullLength = processedDna.size();
+	m_nucleotides.reserve(m_fullLength);
+	m_fullNonGapMask.assign(BitPlanes::wordCount(m_fullLength), 0);
+	for (size_t nuPos = 0; nuPos < m_fullLength; nuPos++) {
+		auto nuc = Nucleotide(processedDna[nuPos]);
+		this->m_nucleotides.push_back(nuc);
+		if (nuc != Nucleotide::Gap) {
+			m_fullNonGapMask[nuPos / BitPlanes::WORD_BITS] |= uint64_t(1) << (nuPos % BitPlanes::WORD_BITS);
+		}
 	}
+	m_activeRow = SequenceRow{ m_nucleotides.data(), m_nucleotides.size(), m_nucleotides.size() };
 }
 
 std::string Sequence::toString() const {
@@ -59,12 +69,12 @@ size_t Sequence::activeLength() const {
 		return m_activePositions->size();
 	}
 	else {
-		return m_nucleotides.size();
+		return m_fullLength;
 	}
 }
 
 size_t Sequence::fullLength() const {
-	return m_nucleotides.size();
+	return m_fullLength;
 }
 
 Sequence::~Sequence() {
@@ -84,9 +94,11 @@ size_t Sequence::computeDistance(const Sequence& other, const bool& ignoreGaps)
 	}
 
 	size_t distance = 0;
+	auto thisRow = m_activeRow.data;
+	auto otherRow = other.m_activeRow.data;
 	for (size_t idx = 0; idx < thisLen; idx++) {
-		auto thisNuc = this->getActiveNuc(idx);
-		auto otherNuc = other.getActiveNuc(idx);
+		auto thisNuc = thisRow[idx];
+		auto otherNuc = otherRow[idx];
 		if (ignoreGaps && (thisNuc == Nucleotide::Gap || otherNuc == Nucleotide::Gap)) {
 			continue;
 		}
@@ -106,9 +118,11 @@ bool Sequence::isSimilarWithGaps(const Sequence& other) const {
 		throw std::length_error("For similarity with gap detection required sequences with the same length.");
 	}
 
+	auto thisRow = m_activeRow.data;
+	auto otherRow = other.m_activeRow.data;
 	for (size_t idx = 0; idx < thisLen; idx++) {
-		auto thisNuc = this->getActiveNuc(idx);
-		auto otherNuc = other.getActiveNuc(idx);
+		auto thisNuc = thisRow[idx];
+		auto otherNuc = otherRow[idx];
 		if (thisNuc != Nucleotide::Gap && thisNuc != otherNuc) {
 			return false;
 		}
@@ -117,16 +131,8 @@ bool Sequence::isSimilarWithGaps(const Sequence& other) const {
 }
 
 size_t Sequence::countGaps() const {
-	size_t gapCount = 0;
-
-	auto seqActiveLen = this->activeLength();
-	for (size_t activeNuIdx = 0; activeNuIdx < seqActiveLen; activeNuIdx++) {
-		if (this->getActiveNuc(activeNuIdx) == Nucleotide::Gap) {
-			gapCount++;
-		}
-	}
-
-	return gapCount;
+	auto row = m_activeRow.data;
+	return static_cast<size_t>(std::count(row, row + activeLength(), Nucleotide::Gap));
 }
 
 size_t Sequence::getOriginalPositionOfActiveNuc(const size_t idx) const {
@@ -139,7 +145,7 @@ size_t Sequence::getOriginalPositionOfActiveNuc(const size_t idx) const {
 }
 
 const Nucleotide& Sequence::getActiveNuc(const size_t idx) const {
-	return m_nucleotides[getOriginalPositionOfActiveNuc(idx)];
+	return m_activeRow[idx];
 }
 
 Sequence::RecombinantType Sequence::getRecombinantType() const {
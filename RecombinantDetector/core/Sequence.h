@@ -1,10 +1,13 @@
 #pragma once
 #include "Nucleotide.h"
+#include "BitPlanes.h"
+#include "SequenceRow.h"
 
 #include <vector>
 #include <string>
 #include <memory>
 
+class ActiveMatrix;
 class Alignment;
 class Triplet;
 
@@ -53,7 +56,15 @@ public:
 
 	void setRecombinantType(RecombinantType newRecombinantType);
 
+	/* The whole sequence. Once the alignment packs its active columns, only the active rows and
+	 * the gap mask below are kept and the vector is released */
 	const std::vector<Nucleotide>& nucleotides() const { return m_nucleotides; };
+	// A bit per column of the whole sequence, set where it has a nucleotide
+	const std::vector<uint64_t>& fullNonGapMask() const { return m_fullNonGapMask; };
+	const BitPlanes& bitPlanes() const { return m_bitPlanes; };
+	/* The active nucleotides. Until the alignment is locked it is the whole sequence,
+	 * afterwards a row of the alignment's ActiveMatrix */
+	const SequenceRow& activeRow() const { return m_activeRow; };
 	time_t data() const { return m_data; };
 
 	bool isOlderThan(const Sequence& other) const;
@@ -69,7 +80,15 @@ private:
 	const time_t m_data;
 
 	std::vector<Nucleotide> m_nucleotides;
+	std::vector<uint64_t> m_fullNonGapMask;
+	size_t m_fullLength;
 	std::shared_ptr<std::vector<size_t>> m_activePositions;
+
+	// Active columns packed by the alignment when it is locked
+	BitPlanes m_bitPlanes;
+
+	std::shared_ptr<const ActiveMatrix> m_activeMatrix;
+	SequenceRow m_activeRow;
 	RecombinantType m_recombinantType;
 };
 
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+#include "Nucleotide.h"
+
+/**
+ * A read-only view of the active nucleotides of a sequence.
+ * The rows of an ActiveMatrix are padded with gaps up to paddedLength, so the kernels may read
+ * whole blocks past the last active column.
+ */
+struct SequenceRow {
+public:
+	const Nucleotide* data = nullptr;
+	size_t length = 0;
+	size_t paddedLength = 0;
+
+	const Nucleotide& operator[](const size_t& idx) const {
+		return data[idx];
+	}
+
+	const Nucleotide* begin() const {
+		return data;
+	}
+
+	const Nucleotide* end() const {
+		return data + length;
+	}
+};
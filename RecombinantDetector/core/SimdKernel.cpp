@@ -0,0 +1,395 @@
+#include "SimdKernel.h"
+
+#include <algorithm>
+
+#include "ActiveMatrix.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+static_assert(ActiveMatrix::ROW_ALIGNMENT % 64 == 0, "The kernels read the rows by blocks of 64 sites");
+
+namespace SimdKernel {
+
+	namespace {
+		const char GAP = static_cast<char>(Nucleotide::Gap);
+
+		/**
+		 * The walk and its mirror, advanced by blocks of sites.
+		 * A block is described relatively to its starting height: the final height, the lowest
+		 * and the highest height and the maximum descent and ascent inside the block.
+		 */
+		class BlockWalk {
+		public:
+			void advance(long upSteps, long downSteps, long netHeight,
+				long minPrefix, long maxPrefix, long innerDescent, long innerAscent) {
+				m_upSteps += upSteps;
+				m_downSteps += downSteps;
+				m_maxDescent = std::max({ m_maxDescent, innerDescent, m_maxHeight - (m_height + minPrefix) });
+				m_maxAscent = std::max({ m_maxAscent, innerAscent, (m_height + maxPrefix) - m_minHeight });
+				m_maxHeight = std::max(m_maxHeight, m_height + maxPrefix);
+				m_minHeight = std::min(m_minHeight, m_height + minPrefix);
+				m_height += netHeight;
+			}
+
+			MirroredWalkSummary summary() const {
+				return MirroredWalkSummary{ m_upSteps, m_downSteps, m_maxDescent, m_maxAscent };
+			}
+
+		private:
+			long m_upSteps = 0;
+			long m_downSteps = 0;
+			long m_height = 0;
+			long m_maxHeight = 0;
+			long m_minHeight = 0;
+			long m_maxDescent = 0;
+			long m_maxAscent = 0;
+		};
+
+		MirroredWalkSummary computeScalar(const Nucleotide* child, const Nucleotide* dad,
+			const Nucleotide* mum, size_t length) {
+			long upSteps = 0;
+			long downSteps = 0;
+			long height = 0;
+			long maxHeight = 0;
+			long minHeight = 0;
+			long maxDescent = 0;
+			long maxAscent = 0;
+
+			for (size_t pos = 0; pos < length; pos++) {
+				if (child[pos] == Nucleotide::Gap || dad[pos] == mum[pos]) {
+					continue;
+				}
+				if (child[pos] == dad[pos] && mum[pos] != Nucleotide::Gap) {
+					upSteps++;
+					height++;
+					maxHeight = std::max(maxHeight, height);
+					maxAscent = std::max(maxAscent, height - minHeight);
+				}
+				else if (child[pos] == mum[pos] && dad[pos] != Nucleotide::Gap) {
+					downSteps++;
+					height--;
+					minHeight = std::min(minHeight, height);
+					maxDescent = std::max(maxDescent, maxHeight - height);
+				}
+			}
+
+			return MirroredWalkSummary{ upSteps, downSteps, maxDescent, maxAscent };
+		}
+
+#ifdef SIMD_KERNEL_X86
+		/*
+		 * The step of a site is +1, -1 or 0 in a signed byte. Within a block of at most 64 sites the
+		 * prefix heights, their running extrema and the descents all fit in a byte.
+		 * Byte shifts bring in zeros, which is the starting height of the block, so the running
+		 * extrema always include it. This does not change the result, since the extrema of the
+		 * walk before the block include the starting height as well.
+		 */
+
+		__attribute__((target("sse4.2")))
+		inline int horizontalMax(__m128i values) {
+			values = _mm_max_epi8(values, _mm_srli_si128(values, 8));
+			values = _mm_max_epi8(values, _mm_srli_si128(values, 4));
+			values = _mm_max_epi8(values, _mm_srli_si128(values, 2));
+			values = _mm_max_epi8(values, _mm_srli_si128(values, 1));
+			return static_cast<int8_t>(_mm_extract_epi8(values, 0));
+		}
+
+		__attribute__((target("sse4.2")))
+		MirroredWalkSummary computeSse42(const Nucleotide* child, const Nucleotide* dad,
+			const Nucleotide* mum, size_t length) {
+			BlockWalk walk;
+			const auto gap = _mm_set1_epi8(GAP);
+
+			for (size_t pos = 0; pos < length; pos += 16) {
+				auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(child + pos));
+				auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dad + pos));
+				auto m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mum + pos));
+
+				auto childGap = _mm_cmpeq_epi8(c, gap);
+				auto dadMatches = _mm_cmpeq_epi8(c, d);
+				auto mumMatches = _mm_cmpeq_epi8(c, m);
+				auto up = _mm_andnot_si128(_mm_or_si128(_mm_or_si128(mumMatches, childGap), _mm_cmpeq_epi8(m, gap)), dadMatches);
+				auto down = _mm_andnot_si128(_mm_or_si128(_mm_or_si128(dadMatches, childGap), _mm_cmpeq_epi8(d, gap)), mumMatches);
+
+				auto upMask = static_cast<unsigned>(_mm_movemask_epi8(up));
+				auto downMask = static_cast<unsigned>(_mm_movemask_epi8(down));
+				if ((upMask | downMask) == 0) {
+					continue;
+				}
+
+				auto heights = _mm_sub_epi8(down, up);
+				heights = _mm_add_epi8(heights, _mm_slli_si128(heights, 1));
+				heights = _mm_add_epi8(heights, _mm_slli_si128(heights, 2));
+				heights = _mm_add_epi8(heights, _mm_slli_si128(heights, 4));
+				heights = _mm_add_epi8(heights, _mm_slli_si128(heights, 8));
+
+				auto maxHeights = _mm_max_epi8(heights, _mm_slli_si128(heights, 1));
+				maxHeights = _mm_max_epi8(maxHeights, _mm_slli_si128(maxHeights, 2));
+				maxHeights = _mm_max_epi8(maxHeights, _mm_slli_si128(maxHeights, 4));
+				maxHeights = _mm_max_epi8(maxHeights, _mm_slli_si128(maxHeights, 8));
+
+				auto minHeights = _mm_min_epi8(heights, _mm_slli_si128(heights, 1));
+				minHeights = _mm_min_epi8(minHeights, _mm_slli_si128(minHeights, 2));
+				minHeights = _mm_min_epi8(minHeights, _mm_slli_si128(minHeights, 4));
+				minHeights = _mm_min_epi8(minHeights, _mm_slli_si128(minHeights, 8));
+
+				walk.advance(__builtin_popcount(upMask), __builtin_popcount(downMask),
+					static_cast<int8_t>(_mm_extract_epi8(heights, 15)),
+					static_cast<int8_t>(_mm_extract_epi8(minHeights, 15)),
+					static_cast<int8_t>(_mm_extract_epi8(maxHeights, 15)),
+					horizontalMax(_mm_sub_epi8(maxHeights, heights)),
+					horizontalMax(_mm_sub_epi8(heights, minHeights)));
+			}
+
+			return walk.summary();
+		}
+
+		__attribute__((target("avx2")))
+		inline int horizontalMax(__m256i values) {
+			return horizontalMax(_mm_max_epi8(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1)));
+		}
+
+		// The last byte of the lower lane, copied to all the bytes of the upper lane
+		__attribute__((target("avx2")))
+		inline __m256i lowerLaneCarry(__m256i values) {
+			return _mm256_shuffle_epi8(_mm256_permute2x128_si256(values, values, 0x08), _mm256_set1_epi8(15));
+		}
+
+		__attribute__((target("avx2")))
+		MirroredWalkSummary computeAvx2(const Nucleotide* child, const Nucleotide* dad,
+			const Nucleotide* mum, size_t length) {
+			BlockWalk walk;
+			const auto gap = _mm256_set1_epi8(GAP);
+
+			for (size_t pos = 0; pos < length; pos += 32) {
+				auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(child + pos));
+				auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dad + pos));
+				auto m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mum + pos));
+
+				auto childGap = _mm256_cmpeq_epi8(c, gap);
+				auto dadMatches = _mm256_cmpeq_epi8(c, d);
+				auto mumMatches = _mm256_cmpeq_epi8(c, m);
+				auto up = _mm256_andnot_si256(_mm256_or_si256(_mm256_or_si256(mumMatches, childGap), _mm256_cmpeq_epi8(m, gap)), dadMatches);
+				auto down = _mm256_andnot_si256(_mm256_or_si256(_mm256_or_si256(dadMatches, childGap), _mm256_cmpeq_epi8(d, gap)), mumMatches);
+
+				auto upMask = static_cast<unsigned>(_mm256_movemask_epi8(up));
+				auto downMask = static_cast<unsigned>(_mm256_movemask_epi8(down));
+				if ((upMask | downMask) == 0) {
+					continue;
+				}
+
+				// Byte shifts stay within the 128-bit lanes, the upper lane is fixed up afterwards
+				auto heights = _mm256_sub_epi8(down, up);
+				heights = _mm256_add_epi8(heights, _mm256_slli_si256(heights, 1));
+				heights = _mm256_add_epi8(heights, _mm256_slli_si256(heights, 2));
+				heights = _mm256_add_epi8(heights, _mm256_slli_si256(heights, 4));
+				heights = _mm256_add_epi8(heights, _mm256_slli_si256(heights, 8));
+				heights = _mm256_add_epi8(heights, lowerLaneCarry(heights));
+
+				auto maxHeights = _mm256_max_epi8(heights, _mm256_slli_si256(heights, 1));
+				maxHeights = _mm256_max_epi8(maxHeights, _mm256_slli_si256(maxHeights, 2));
+				maxHeights = _mm256_max_epi8(maxHeights, _mm256_slli_si256(maxHeights, 4));
+				maxHeights = _mm256_max_epi8(maxHeights, _mm256_slli_si256(maxHeights, 8));
+				maxHeights = _mm256_max_epi8(maxHeights, lowerLaneCarry(maxHeights));
+
+				auto minHeights = _mm256_min_epi8(heights, _mm256_slli_si256(heights, 1));
+				minHeights = _mm256_min_epi8(minHeights, _mm256_slli_si256(minHeights, 2));
+				minHeights = _mm256_min_epi8(minHeights, _mm256_slli_si256(minHeights, 4));
+				minHeights = _mm256_min_epi8(minHeights, _mm256_slli_si256(minHeights, 8));
+				minHeights = _mm256_min_epi8(minHeights, lowerLaneCarry(minHeights));
+
+				walk.advance(__builtin_popcount(upMask), __builtin_popcount(downMask),
+					static_cast<int8_t>(_mm256_extract_epi8(heights, 31)),
+					static_cast<int8_t>(_mm256_extract_epi8(minHeights, 31)),
+					static_cast<int8_t>(_mm256_extract_epi8(maxHeights, 31)),
+					horizontalMax(_mm256_sub_epi8(maxHeights, heights)),
+					horizontalMax(_mm256_sub_epi8(heights, minHeights)));
+			}
+
+			return walk.summary();
+		}
+
+		/*
+		 * The plain extracts of GCC merge into an undefined register, which it reports as maybe
+		 * uninitialized. The zero-masked extracts with a full mask are the same instructions.
+		 */
+		__attribute__((target("avx512f,avx512bw,avx2")))
+		inline int horizontalMax(__m512i values) {
+			return horizontalMax(_mm256_max_epi8(_mm512_maskz_extracti64x4_epi64(0xF, values, 0),
+				_mm512_maskz_extracti64x4_epi64(0xF, values, 1)));
+		}
+
+		__attribute__((target("avx512f,avx512bw,avx2")))
+		inline int lastByte(__m512i values) {
+			return static_cast<int8_t>(_mm_extract_epi8(_mm512_maskz_extracti32x4_epi32(0xF, values, 3), 15));
+		}
+
+		// The 128-bit lanes moved up by one and by two lanes, zeros are shifted in
+		__attribute__((target("avx512f,avx512bw,avx2")))
+		inline __m512i shiftLanesByOne(__m512i values) {
+			return _mm512_maskz_shuffle_i32x4(0xFFF0, values, values, _MM_SHUFFLE(2, 1, 0, 0));
+		}
+
+		__attribute__((target("avx512f,avx512bw,avx2")))
+		inline __m512i shiftLanesByTwo(__m512i values) {
+			return _mm512_maskz_shuffle_i32x4(0xFF00, values, values, _MM_SHUFFLE(1, 0, 0, 0));
+		}
+
+		__attribute__((target("avx512f,avx512bw,avx2")))
+		MirroredWalkSummary computeAvx512(const Nucleotide* child, const Nucleotide* dad,
+			const Nucleotide* mum, size_t length) {
+			BlockWalk walk;
+			const auto gap = _mm512_set1_epi8(GAP);
+			const auto one = _mm512_set1_epi8(1);
+			const auto lastOfLane = _mm512_set1_epi8(15);
+
+			for (size_t pos = 0; pos < length; pos += 64) {
+				auto c = _mm512_loadu_si512(child + pos);
+				auto d = _mm512_loadu_si512(dad + pos);
+				auto m = _mm512_loadu_si512(mum + pos);
+
+				auto childGap = _mm512_cmpeq_epi8_mask(c, gap);
+				auto dadMatches = _mm512_cmpeq_epi8_mask(c, d);
+				auto mumMatches = _mm512_cmpeq_epi8_mask(c, m);
+				__mmask64 upMask = dadMatches & ~(mumMatches | childGap | _mm512_cmpeq_epi8_mask(m, gap));
+				__mmask64 downMask = mumMatches & ~(dadMatches | childGap | _mm512_cmpeq_epi8_mask(d, gap));
+				if ((upMask | downMask) == 0) {
+					continue;
+				}
+
+				// The scans run within the 128-bit lanes, then the results of the lower lanes are carried up
+				auto heights = _mm512_sub_epi8(_mm512_maskz_mov_epi8(upMask, one), _mm512_maskz_mov_epi8(downMask, one));
+				heights = _mm512_add_epi8(heights, _mm512_bslli_epi128(heights, 1));
+				heights = _mm512_add_epi8(heights, _mm512_bslli_epi128(heights, 2));
+				heights = _mm512_add_epi8(heights, _mm512_bslli_epi128(heights, 4));
+				heights = _mm512_add_epi8(heights, _mm512_bslli_epi128(heights, 8));
+				auto carry = _mm512_shuffle_epi8(heights, lastOfLane);
+				carry = _mm512_add_epi8(carry, shiftLanesByOne(carry));
+				carry = _mm512_add_epi8(carry, shiftLanesByTwo(carry));
+				heights = _mm512_add_epi8(heights, shiftLanesByOne(carry));
+
+				auto maxHeights = _mm512_max_epi8(heights, _mm512_bslli_epi128(heights, 1));
+				maxHeights = _mm512_max_epi8(maxHeights, _mm512_bslli_epi128(maxHeights, 2));
+				maxHeights = _mm512_max_epi8(maxHeights, _mm512_bslli_epi128(maxHeights, 4));
+				maxHeights = _mm512_max_epi8(maxHeights, _mm512_bslli_epi128(maxHeights, 8));
+				carry = _mm512_shuffle_epi8(maxHeights, lastOfLane);
+				carry = _mm512_max_epi8(carry, shiftLanesByOne(carry));
+				carry = _mm512_max_epi8(carry, shiftLanesByTwo(carry));
+				maxHeights = _mm512_max_epi8(maxHeights, shiftLanesByOne(carry));
+
+				auto minHeights = _mm512_min_epi8(heights, _mm512_bslli_epi128(heights, 1));
+				minHeights = _mm512_min_epi8(minHeights, _mm512_bslli_epi128(minHeights, 2));
+				minHeights = _mm512_min_epi8(minHeights, _mm512_bslli_epi128(minHeights, 4));
+				minHeights = _mm512_min_epi8(minHeights, _mm512_bslli_epi128(minHeights, 8));
+				carry = _mm512_shuffle_epi8(minHeights, lastOfLane);
+				carry = _mm512_min_epi8(carry, shiftLanesByOne(carry));
+				carry = _mm512_min_epi8(carry, shiftLanesByTwo(carry));
+				minHeights = _mm512_min_epi8(minHeights, shiftLanesByOne(carry));
+
+				walk.advance(__builtin_popcountll(upMask), __builtin_popcountll(downMask),
+					lastByte(heights), lastByte(minHeights), lastByte(maxHeights),
+					horizontalMax(_mm512_sub_epi8(maxHeights, heights)),
+					horizontalMax(_mm512_sub_epi8(heights, minHeights)));
+			}
+
+			return walk.summary();
+		}
+#endif
+
+		typedef MirroredWalkSummary(*KernelFunction)(const Nucleotide*, const Nucleotide*, const Nucleotide*, size_t);
+
+		KernelFunction kernelOf(Level level) {
+			switch (level) {
+#ifdef SIMD_KERNEL_X86
+			case Level::AVX512:
+				return computeAvx512;
+			case Level::AVX2:
+				return computeAvx2;
+			case Level::SSE42:
+				return computeSse42;
+#endif
+			default:
+				return computeScalar;
+			}
+		}
+
+		Level g_level = detectLevel();
+		KernelFunction g_kernel = kernelOf(g_level);
+	}   // unnamed
+
+	Level detectLevel() {
+#ifdef SIMD_KERNEL_X86
+		// May run during the static initialisation, before the runtime did it
+		__builtin_cpu_init();
+#endif
+		for (auto level : { Level::AVX512, Level::AVX2, Level::SSE42 }) {
+			if (isSupported(level)) {
+				return level;
+			}
+		}
+		return Level::Scalar;
+	}
+
+	bool isSupported(Level level) {
+		switch (level) {
+#ifdef SIMD_KERNEL_X86
+		case Level::AVX512:
+			return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+		case Level::AVX2:
+			return __builtin_cpu_supports("avx2");
+		case Level::SSE42:
+			return __builtin_cpu_supports("sse4.2");
+#endif
+		case Level::Scalar:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void selectLevel(Level level) {
+		g_level = level;
+		g_kernel = kernelOf(level);
+	}
+
+	Level selectedLevel() {
+		return g_level;
+	}
+
+	const char* levelName(Level level) {
+		switch (level) {
+		case Level::AVX512:
+			return "avx512";
+		case Level::AVX2:
+			return "avx2";
+		case Level::SSE42:
+			return "sse4.2";
+		default:
+			return "scalar";
+		}
+	}
+
+	bool levelFromName(const std::string& name, Level& level) {
+		if (name == "auto") {
+			level = detectLevel();
+			return true;
+		}
+		for (auto candidate : { Level::AVX512, Level::AVX2, Level::SSE42, Level::Scalar }) {
+			if (name == levelName(candidate)) {
+				level = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	MirroredWalkSummary computeMirroredSteps(const Nucleotide* child,
+		const Nucleotide* dad,
+		const Nucleotide* mum,
+		size_t length) {
+		return g_kernel(child, dad, mum, length);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+#include "Nucleotide.h"
+#include "TripletKernel.h"
+
+/**
+ * Computes m, n and k of a triplet on dense rows of active nucleotides, comparing 16, 32 or 64
+ * sites per instruction. The steps of a block are turned into in-register prefix sums and
+ * running extrema of the heights, so a block is folded into the walk with a few reductions.
+ * The instruction set is detected at runtime and can be forced for benchmarking.
+ */
+namespace SimdKernel {
+	enum class Level {
+		Scalar,
+		SSE42,
+		AVX2,
+		AVX512
+	};
+
+	// The best level supported by the CPU
+	Level detectLevel();
+
+	bool isSupported(Level level);
+
+	// Not thread-safe, must be called before the detection starts
+	void selectLevel(Level level);
+
+	Level selectedLevel();
+
+	const char* levelName(Level level);
+
+	// "auto" selects the detected level, returns false for an unknown name
+	bool levelFromName(const std::string& name, Level& level);
+
+	/**
+	 * Compute the summaries of (child, dad, mum) and (child, mum, dad) with the selected level.
+	 * @param length The padded length of the rows, a multiple of 64 (see ActiveMatrix).
+	 */
+	MirroredWalkSummary computeMirroredSteps(const Nucleotide* child,
+		const Nucleotide* dad,
+		const Nucleotide* mum,
+		size_t length);
+}
@@ -1,5 +1,9 @@
 #include "Triplet.h"
 
+#include <algorithm>
+#include <cassert>
+
+#include "TripletKernel.h"
 #include "../app/PTable.h"
 #include "../app/TextFile.h"
 #include "../app/App.h"
@@ -17,24 +21,56 @@ void Triplet::setAcceptApproxPVal(const bool& acceptApproxPVal) {
 	Triplet::m_isApproximatePValAccepted = acceptApproxPVal;
 }
 
+Triplet::RandomWalk& Triplet::threadRandomWalk() {
+	// The buffers keep their capacity, so a thread allocates them only for its first triplets
+	thread_local RandomWalk walk;
+	return walk;
+}
+
 std::shared_ptr<Triplet> Triplet::create() {
 	return std::make_shared<Triplet>();
 }
 
+double Triplet::pValueOf(const RandomWalkSummary& summary, bool& isExact) {
+	isExact = false;
+	if (PTable::instance().canCalculateExact(summary.upSteps, summary.downSteps, summary.maxDescent)) {
+		isExact = true;
+		return PTable::instance().getExactPValue(summary.upSteps, summary.downSteps, summary.maxDescent);
+	}
+	if (m_isApproximatePValAccepted) {
+		return PTable::approxPValue(summary.upSteps, summary.downSteps, summary.maxDescent);
+	}
+	return Double::NOT_SET;
+}
+
 Triplet::Triplet()
 	: m_child(nullptr), m_dad(nullptr), m_mum(nullptr),
+	m_dadIdx(ULong::NOT_SET), m_mumIdx(ULong::NOT_SET),
 	m_leftBreakPoints(), m_rightBreakPoints(),
 	m_upStep(0), m_downStep(0), m_maxDescent(0), m_minRecombinantLength(0),
 	m_exactPValue(Double::NOT_SET), m_approxPValue(Double::NOT_SET),
-	m_randomWalkHeights(), m_mostRecentMaxHeights() {
+	m_breakPointsPairs() {
 }
 
 void Triplet::reassign(const SequencePtr& newChild,
 	const SequencePtr& newDad,
 	const SequencePtr& newMum) {
+	reassign(newChild, newDad, newMum,
+		TripletKernel::computeSteps(newChild->bitPlanes(), newDad->bitPlanes(), newMum->bitPlanes()),
+		ULong::NOT_SET, ULong::NOT_SET);
+}
+
+void Triplet::reassign(const SequencePtr& newChild,
+	const SequencePtr& newDad,
+	const SequencePtr& newMum,
+	const RandomWalkSummary& summary,
+	const size_t& dadIdx,
+	const size_t& mumIdx) {
 	m_child = newChild;
 	m_dad = newDad;
 	m_mum = newMum;
+	m_dadIdx = dadIdx;
+	m_mumIdx = mumIdx;
 
 	m_minRecombinantLength = 0;
 
@@ -42,68 +78,102 @@ void Triplet::reassign(const SequencePtr& newChild,
 	m_rightBreakPoints.clear();
 	m_breakPointsPairs.clear();
 
-	updateSteps();
+	m_upStep = summary.upSteps;
+	m_downStep = summary.downSteps;
+	m_maxDescent = summary.maxDescent;
+
 	computePValues();
 }
 
-void Triplet::updateSteps() {
-	size_t activeSeqLen = m_child->activeLength();
+void Triplet::reassign(const SequencePtr& newChild,
+	const SequencePtr& newDad,
+	const SequencePtr& newMum,
+	const TripletRecord& record) {
+	m_child = newChild;
+	m_dad = newDad;
+	m_mum = newMum;
+	m_dadIdx = record.dadIdx;
+	m_mumIdx = record.mumIdx;
+
+	m_minRecombinantLength = 0;
+
+	m_leftBreakPoints.clear();
+	m_rightBreakPoints.clear();
+	m_breakPointsPairs.clear();
 
-	m_upStep = 0;
-	m_downStep = 0;
-	m_maxDescent = 0;
+	m_upStep = record.upSteps;
+	m_downStep = record.downSteps;
+	m_maxDescent = record.maxDescent;
 
-	m_randomWalkHeights.resize(activeSeqLen + 1);
-	m_mostRecentMaxHeights.resize(activeSeqLen + 1);
-	m_randomWalkHeights[0] = 0;
-	m_mostRecentMaxHeights[0] = 0;
+	m_exactPValue = record.isApproximate ? Double::NOT_SET : record.pValue;
+	m_approxPValue = record.isApproximate ? record.pValue : Double::NOT_SET;
+}
+
+void Triplet::buildRandomWalk(RandomWalk& walk) const {
+	size_t activeSeqLen = m_child->activeLength();
+	auto& heights = walk.heights;
+	auto& mostRecentMaxHeights = walk.mostRecentMaxHeights;
 
+	heights.resize(activeSeqLen + 1);
+	mostRecentMaxHeights.resize(activeSeqLen + 1);
+	heights[0] = 0;
+	mostRecentMaxHeights[0] = 0;
+
+	long long maxDescent = 0;
 	for (size_t activeNuIdx = 0; activeNuIdx < activeSeqLen; activeNuIdx++) {
 		auto dadNu = m_dad->getActiveNuc(activeNuIdx);
 		auto mumNu = m_mum->getActiveNuc(activeNuIdx);
 		auto childNu = m_child->getActiveNuc(activeNuIdx);
 
-		auto currentHeight = m_randomWalkHeights[activeNuIdx];
+		auto currentHeight = heights[activeNuIdx];
 		if (dadNu != Nucleotide::Gap && mumNu != Nucleotide::Gap && childNu != Nucleotide::Gap) {
 			if (dadNu == childNu && mumNu != childNu) {
-				m_upStep++;
 				currentHeight++;
-
 			}
 			else if (dadNu != childNu && mumNu == childNu) {
-				m_downStep++;
 				currentHeight--;
 			}
 		}
-		m_randomWalkHeights[activeNuIdx + 1] = currentHeight;
+		heights[activeNuIdx + 1] = currentHeight;
 
-		if (currentHeight > m_mostRecentMaxHeights[activeNuIdx]) {
-			m_mostRecentMaxHeights[activeNuIdx + 1] = currentHeight;
+		if (currentHeight > mostRecentMaxHeights[activeNuIdx]) {
+			mostRecentMaxHeights[activeNuIdx + 1] = currentHeight;
 		}
 		else {
-			m_mostRecentMaxHeights[activeNuIdx + 1] = m_mostRecentMaxHeights[activeNuIdx];
+			mostRecentMaxHeights[activeNuIdx + 1] = mostRecentMaxHeights[activeNuIdx];
 		}
 
-		auto maxDescentToThisPoint = m_mostRecentMaxHeights[activeNuIdx + 1] - currentHeight;
-		if (m_maxDescent < maxDescentToThisPoint) {
-			m_maxDescent = maxDescentToThisPoint;
+		auto maxDescentToThisPoint = mostRecentMaxHeights[activeNuIdx + 1] - currentHeight;
+		if (maxDescent < maxDescentToThisPoint) {
+			maxDescent = maxDescentToThisPoint;
 		}
 	}
+
+	// The bit-packed kernel and the site-by-site walk must always agree
+	assert(maxDescent == m_maxDescent);
+
+	// The segments of the breakpoint pairs also span the inactive columns, so the counts cover the full length
+	const auto& childMask = m_child->m_fullNonGapMask;
+	const auto& dadMask = m_dad->m_fullNonGapMask;
+	const auto& mumMask = m_mum->m_fullNonGapMask;
+	size_t fullSeqLen = m_child->fullLength();
+	auto& nonGappedSiteCounts = walk.nonGappedSiteCounts;
+
+	nonGappedSiteCounts.resize(fullSeqLen + 1);
+	nonGappedSiteCounts[0] = 0;
+	for (size_t origNuPos = 0; origNuPos < fullSeqLen; origNuPos++) {
+		auto wordIdx = origNuPos / BitPlanes::WORD_BITS;
+		auto nonGapped = childMask[wordIdx] & dadMask[wordIdx] & mumMask[wordIdx];
+		nonGappedSiteCounts[origNuPos + 1] = nonGappedSiteCounts[origNuPos]
+			+ static_cast<uint32_t>((nonGapped >> (origNuPos % BitPlanes::WORD_BITS)) & 1);
+	}
 }
 
 void Triplet::computePValues() {
-	m_exactPValue = Double::NOT_SET;
-	m_approxPValue = Double::NOT_SET;
-
-
-	if (PTable::instance().canCalculateExact(m_upStep, m_downStep, m_maxDescent)) {
-		m_exactPValue = PTable::instance().getExactPValue(m_upStep, m_downStep, m_maxDescent);
-	}
-	else if (m_isApproximatePValAccepted) {
-		m_approxPValue = PTable::approxPValue(m_upStep,
-			m_downStep,
-			m_maxDescent);
-	}
+	bool isExact = false;
+	auto pValue = pValueOf(RandomWalkSummary{ m_upStep, m_downStep, m_maxDescent }, isExact);
+	m_exactPValue = isExact ? pValue : Double::NOT_SET;
+	m_approxPValue = isExact ? Double::NOT_SET : pValue;
 }
 
 double Triplet::getPValue() const {
@@ -115,37 +185,41 @@ double Triplet::getPValue() const {
 	}
 }
 
-void Triplet::seekBreakPoints() {
-	if (!m_leftBreakPoints.empty() && !m_rightBreakPoints.empty()) {
-		return; // break-points are already calculated
-	}
+void Triplet::seekBreakPoints(const RandomWalk& walk) {
+	const auto& heights = walk.heights;
+	const auto& mostRecentMaxHeights = walk.mostRecentMaxHeights;
 
-	auto randomWalkLength = m_randomWalkHeights.size();
-	auto randomWalkPos = randomWalkLength;
+	m_leftBreakPoints.clear();
+	m_rightBreakPoints.clear();
+
+	auto randomWalkPos = heights.size();
 	long heightOfLeftBp = Long::NOT_SET;
 	do {
 		randomWalkPos--;
-		if (m_mostRecentMaxHeights[randomWalkPos] == m_randomWalkHeights[randomWalkPos] + m_maxDescent) {
+		if (mostRecentMaxHeights[randomWalkPos] == heights[randomWalkPos] + m_maxDescent) {
 			// This position is a right breakpoint
-			auto breakPoint = buildBpFromRight(randomWalkPos, true);
-			m_rightBreakPoints.push_back(breakPoint);
-			heightOfLeftBp = m_mostRecentMaxHeights[randomWalkPos];
+			m_rightBreakPoints.push_back(buildBpFromRight(walk, randomWalkPos, true));
+			heightOfLeftBp = mostRecentMaxHeights[randomWalkPos];
 
 		}
-		else if (m_randomWalkHeights[randomWalkPos] == heightOfLeftBp
+		else if (heights[randomWalkPos] == heightOfLeftBp
 			&& !m_rightBreakPoints.empty()) {
 			// This position is a left breakpoint
-			auto breakPoint = buildBpFromRight(randomWalkPos, false);
-			m_leftBreakPoints.push_back(breakPoint);
+			m_leftBreakPoints.push_back(buildBpFromRight(walk, randomWalkPos, false));
 		}
 	} while (randomWalkPos > 0);
+
+	// The walk is scanned from the right, the breakpoints are kept from left to right
+	std::reverse(m_leftBreakPoints.begin(), m_leftBreakPoints.end());
+	std::reverse(m_rightBreakPoints.begin(), m_rightBreakPoints.end());
 }
 
-BreakPointPtr Triplet::buildBpFromRight(size_t& randomWalkPos,
-	const bool& buildingRightBp) {
+BreakPoint Triplet::buildBpFromRight(const RandomWalk& walk, size_t& randomWalkPos,
+	const bool& buildingRightBp) const {
+	const auto& heights = walk.heights;
 	auto rightActiveNuIdx = randomWalkPos;
 	while (randomWalkPos > 0
-		&& m_randomWalkHeights[randomWalkPos - 1] == m_randomWalkHeights[randomWalkPos]) {
+		&& heights[randomWalkPos - 1] == heights[randomWalkPos]) {
 		randomWalkPos--;
 	}
 	auto leftActiveNuIdx = randomWalkPos;
@@ -173,9 +247,9 @@ BreakPointPtr Triplet::buildBpFromRight(size_t& randomWalkPos,
 		rightOrigNuPos++;
 	}
 
-	return BreakPoint::create(leftOrigNuPos,
-		rightOrigNuPos,
-		m_randomWalkHeights[randomWalkPos]);
+	return BreakPoint{ static_cast<uint32_t>(leftOrigNuPos),
+		static_cast<uint32_t>(rightOrigNuPos),
+		heights[randomWalkPos] };
 }
 
 void Triplet::seekBreakPointPairs() {
@@ -183,61 +257,51 @@ void Triplet::seekBreakPointPairs() {
 		return; // break-point pairs are already calculated
 	}
 
-	seekBreakPoints();
+	auto& walk = threadRandomWalk();
+	buildRandomWalk(walk);
+	seekBreakPoints(walk);
 	m_minRecombinantLength = ULong::MAX;
 
-	// Loop through the breakpoint vectors from right to left since the leftmost breakpoints
-	// are stored at the right-end of the vectors.
-	for (auto leftBpIter = m_leftBreakPoints.rbegin();
-		leftBpIter != m_leftBreakPoints.rend(); ++leftBpIter) {
-		for (auto rightBpIter = m_rightBreakPoints.rbegin();
-			rightBpIter != m_rightBreakPoints.rend(); ++rightBpIter) {
-
-			if ((*leftBpIter)->rightBound < (*rightBpIter)->leftBound) {
-				if ((*leftBpIter)->height - (*rightBpIter)->height == m_maxDescent) {
-					m_breakPointsPairs.emplace_back(*leftBpIter, *rightBpIter);
-
-					auto mumSegmentLength = countNonGappedSites(
-						(*leftBpIter)->rightBound,
-						(*rightBpIter)->leftBound);
-					if (m_minRecombinantLength > mumSegmentLength) {
-						m_minRecombinantLength = mumSegmentLength;
-					}
-
-					auto dadSegmentLength =
-						countNonGappedSites(0,
-							(*leftBpIter)->leftBound)
-						+ countNonGappedSites((*rightBpIter)->rightBound,
-							m_child->fullLength());
-					if (m_minRecombinantLength > dadSegmentLength) {
-						m_minRecombinantLength = dadSegmentLength;
-					}
-
-				}
-				else {
-					break;
-				}
+	// Both vectors are ordered by position. The first right breakpoint past a left one only moves
+	// to the right with it, and the pairs of the left one are the run of right breakpoints from
+	// there at the height of the max descent below it.
+	size_t firstRightIdx = 0;
+	for (size_t leftIdx = 0; leftIdx < m_leftBreakPoints.size(); leftIdx++) {
+		const auto& leftBp = m_leftBreakPoints[leftIdx];
+		while (firstRightIdx < m_rightBreakPoints.size()
+			&& m_rightBreakPoints[firstRightIdx].leftBound <= leftBp.rightBound) {
+			firstRightIdx++;
+		}
+
+		for (auto rightIdx = firstRightIdx; rightIdx < m_rightBreakPoints.size()
+			&& leftBp.height - m_rightBreakPoints[rightIdx].height == m_maxDescent; rightIdx++) {
+			const auto& rightBp = m_rightBreakPoints[rightIdx];
+			m_breakPointsPairs.push_back({ static_cast<uint32_t>(leftIdx), static_cast<uint32_t>(rightIdx) });
+
+			auto mumSegmentLength = countNonGappedSites(walk, leftBp.rightBound, rightBp.leftBound);
+			if (m_minRecombinantLength > mumSegmentLength) {
+				m_minRecombinantLength = mumSegmentLength;
+			}
+
+			auto dadSegmentLength = countNonGappedSites(walk, 0, leftBp.leftBound)
+				+ countNonGappedSites(walk, rightBp.rightBound, m_child->fullLength());
+			if (m_minRecombinantLength > dadSegmentLength) {
+				m_minRecombinantLength = dadSegmentLength;
 			}
 		}
 	}
+}
 
-	if (m_minRecombinantLength >= Triplet::m_longRecombinantThreshold
-		&& m_child->getRecombinantType() == Sequence::RecombinantType::Short) {
-		m_child->setRecombinantType(Sequence::RecombinantType::Long);
-	}
+bool Triplet::isLongRecombinant() const {
+	return m_minRecombinantLength >= Triplet::m_longRecombinantThreshold;
 }
 
-size_t Triplet::countNonGappedSites(const size_t& leftOrigNuPos,
+size_t Triplet::countNonGappedSites(const RandomWalk& walk, const size_t& leftOrigNuPos,
 	const size_t& rightOrigNuPos) const {
-	size_t nNonGappedSites = 0;
-	for (auto origNuPos = leftOrigNuPos; origNuPos < rightOrigNuPos; origNuPos++) {
-		if (m_child->m_nucleotides[origNuPos] != Nucleotide::Gap
-			&& m_dad->m_nucleotides[origNuPos] != Nucleotide::Gap
-			&& m_mum->m_nucleotides[origNuPos] != Nucleotide::Gap) {
-			nNonGappedSites++;
-		}
+	if (leftOrigNuPos >= rightOrigNuPos) {
+		return 0;
 	}
-	return nNonGappedSites;
+	return walk.nonGappedSiteCounts[rightOrigNuPos] - walk.nonGappedSiteCounts[leftOrigNuPos];
 }
 
 std::string Triplet::info() const {
@@ -277,12 +341,12 @@ bool Triplet::statisticallyBetter(const Triplet& another) const {
 	return false;
 }
 
-std::string Triplet::toString(const std::string& infoSeparator) const {
+std::string Triplet::toString(const StatisticalUtils::Correction& correction, const std::string& infoSeparator) const {
 	std::string tripletInfo;
 	char stringBuffer[10000];
 
 	auto pValue = getPValue();
-	auto dunnSidak = StatisticalUtils::dunnSidak(pValue);
+	auto correctedPValue = correction.correct(pValue, 0);
 
 	auto separatorCStr = infoSeparator.c_str();
 	if (UserSettings::instance().simplifiedOutput){
@@ -292,7 +356,7 @@ std::string Triplet::toString(const std::string& infoSeparator) const {
 			m_mum->name().c_str(), separatorCStr,
 			m_child->name().c_str(), separatorCStr,
 			log10(pValue), separatorCStr,
-			dunnSidak
+			correctedPValue
 		);
 	}
 	else{
@@ -307,8 +371,8 @@ std::string Triplet::toString(const std::string& infoSeparator) const {
 			pValue, separatorCStr,
 			(!hasExactPVal()), separatorCStr,
 			log10(pValue), separatorCStr,
-			dunnSidak, separatorCStr,
-			dunnSidak
+			correctedPValue, separatorCStr,
+			correctedPValue
 		);
 	}
 
@@ -318,7 +382,7 @@ std::string Triplet::toString(const std::string& infoSeparator) const {
 		sprintf(stringBuffer, "%s%lu", separatorCStr, m_minRecombinantLength);
 		tripletInfo += std::string(stringBuffer);
 		for (const auto& bpPair : m_breakPointsPairs) {
-			tripletInfo += infoSeparator + bpPair.toString();
+			tripletInfo += infoSeparator + bpPair.toString(m_leftBreakPoints, m_rightBreakPoints);
 		}
 	}
 
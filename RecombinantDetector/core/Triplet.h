@@ -5,6 +5,9 @@
 
 #include "Sequence.h"
 #include "BreakPoint.h"
+#include "TripletKernel.h"
+#include "TripletRecord.h"
+#include "../utils/StatisticalUtils.h"
 
 class TripletPool;
 
@@ -18,6 +21,12 @@ public:
 
 	static std::shared_ptr<Triplet> create();
 
+	/**
+	 * The p-value of a walk: exact from the P-value table if possible, otherwise approximated
+	 * if approximate p-values are accepted. Not set if neither is possible.
+	 */
+	static double pValueOf(const RandomWalkSummary& summary, bool& isExact);
+
 	Triplet(const Triplet& rhs) = delete;
 	Triplet(Triplet&&) = delete;
 	Triplet& operator=(const Triplet&) = delete;
@@ -27,29 +36,62 @@ public:
 
 	void reassign(const SequencePtr& newChild, const SequencePtr& newDad, const SequencePtr& newMum);
 
+	/**
+	 * Reassign the triplet using a walk summary that has already been computed
+	 * (e.g. together with the mirrored triplet).
+	 * dadIdx and mumIdx are the indices of the parents in the active parent list.
+	 */
+	void reassign(const SequencePtr& newChild, const SequencePtr& newDad, const SequencePtr& newMum,
+		const RandomWalkSummary& summary, const size_t& dadIdx, const size_t& mumIdx);
+
+	// Rebuild a saved triplet, the p-value is taken from the record
+	void reassign(const SequencePtr& newChild, const SequencePtr& newDad, const SequencePtr& newMum,
+		const TripletRecord& record);
+
 	double getPValue() const;
 
+	// The child is left untouched, so triplets of the same child can be searched concurrently
 	void seekBreakPointPairs();
 
+	// Whether the shortest segment of the breakpoint pairs reaches the long recombinant threshold
+	bool isLongRecombinant() const;
+
 	bool hasExactPVal() const;
 	bool hasPVal() const;
 
 	std::string info() const;
 
-	std::string toString(const std::string& infoSeparator = ",") const;
+	std::string toString(const StatisticalUtils::Correction& correction, const std::string& infoSeparator = ",") const;
 
 	bool breakPointsComputed() const;
 	bool statisticallyBetter(const Triplet& another) const;
 
 private:
-	void updateSteps();
+	// The walk of a triplet, only needed by its breakpoint search
+	struct RandomWalk {
+		std::vector<long long> heights;
+
+		// Stores the most recent maximum height up to the current active nucleotide position
+		std::vector<long long> mostRecentMaxHeights;
+
+		// The number of sites before each original position where none of the three sequences has a gap
+		std::vector<uint32_t> nonGappedSiteCounts;
+	};
+
+	// The walk buffers of the calling thread, reused by all its triplets
+	static RandomWalk& threadRandomWalk();
+
+	// Fill the heights of the random walk, site by site. Only breakpoint search needs them,
+	// so the detection loop itself never touches these arrays.
+	void buildRandomWalk(RandomWalk& walk) const;
 	void computePValues();
-	void seekBreakPoints();
+	void seekBreakPoints(const RandomWalk& walk);
 
-	BreakPointPtr buildBpFromRight(size_t& randomWalkPos,
-		const bool& buildingRightBp);
+	BreakPoint buildBpFromRight(const RandomWalk& walk, size_t& randomWalkPos,
+		const bool& buildingRightBp) const;
 
-	size_t countNonGappedSites(const size_t& leftOrigNuPos,
+	// The sites in [leftOrigNuPos, rightOrigNuPos) without a gap, from the counts built with the walk
+	size_t countNonGappedSites(const RandomWalk& walk, const size_t& leftOrigNuPos,
 		const size_t& rightOrigNuPos) const;
 
 private:
@@ -62,6 +104,9 @@ private:
 	SequencePtr m_dad;
 	SequencePtr m_mum;
 
+	size_t m_dadIdx;
+	size_t m_mumIdx;
+
 	long m_upStep;
 	long m_downStep;
 	long m_maxDescent;
@@ -69,13 +114,9 @@ private:
 	double m_exactPValue;
 	double m_approxPValue;
 
-	std::vector<long long> m_randomWalkHeights;
-
-	// Stores the most recent maximum height up to the current active nucleotide position
-	std::vector<long long> m_mostRecentMaxHeights;
-
-	std::vector<BreakPointPtr> m_leftBreakPoints;
-	std::vector<BreakPointPtr> m_rightBreakPoints;
+	// Ordered by position
+	std::vector<BreakPoint> m_leftBreakPoints;
+	std::vector<BreakPoint> m_rightBreakPoints;
 	std::vector<BreakPointPair> m_breakPointsPairs;
 };
 
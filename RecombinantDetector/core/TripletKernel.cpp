@@ -0,0 +1,166 @@
+#include "TripletKernel.h"
+
+#include <algorithm>
+#include <array>
+
+namespace TripletKernel {
+
+	namespace {
+		/**
+		 * The walk over 8 sites described relatively to its starting height:
+		 * the final height, the lowest and the highest height reached after a step
+		 * and the maximum descent inside the byte.
+		 */
+		struct ByteSummary {
+			int8_t netHeight;
+			int8_t minPrefix;
+			int8_t maxPrefix;
+			int8_t maxDescent;
+		};
+
+		typedef std::array<ByteSummary, 1 << 16> ByteSummaryTable;
+
+		// Indexed by (upByte << 8) | downByte
+		ByteSummaryTable buildByteSummaryTable() {
+			ByteSummaryTable table{};
+			for (int upByte = 0; upByte < 256; upByte++) {
+				for (int downByte = 0; downByte < 256; downByte++) {
+					int height = 0;
+					int maxHeight = 0;
+					ByteSummary summary{ 0, 0, 0, 0 };
+					for (int bit = 0; bit < 8; bit++) {
+						if (upByte & (1 << bit)) {
+							height++;
+						}
+						else if (downByte & (1 << bit)) {
+							height--;
+						}
+						maxHeight = std::max(maxHeight, height);
+						summary.minPrefix = static_cast<int8_t>(std::min<int>(summary.minPrefix, height));
+						summary.maxPrefix = static_cast<int8_t>(std::max<int>(summary.maxPrefix, height));
+						summary.maxDescent = static_cast<int8_t>(std::max<int>(summary.maxDescent, maxHeight - height));
+					}
+					summary.netHeight = static_cast<int8_t>(height);
+					table[(upByte << 8) | downByte] = summary;
+				}
+			}
+			return table;
+		}
+
+		const ByteSummaryTable& byteSummaryTable() {
+			static const ByteSummaryTable table = buildByteSummaryTable();
+			return table;
+		}
+		/**
+		 * The state of the walk and of its mirror, advanced by whole words of steps.
+		 */
+		class WalkState {
+		public:
+			void advance(const uint64_t& upMask, const uint64_t& downMask) {
+				if ((upMask | downMask) == 0) {
+					return;
+				}
+
+				long nUp = popCount(upMask);
+				long nDown = popCount(downMask);
+				m_upSteps += nUp;
+				m_downSteps += nDown;
+
+				if (downMask == 0) {
+					// The walk only rises within this word
+					m_height += nUp;
+					m_maxHeight = std::max(m_maxHeight, m_height);
+					m_maxAscent = std::max(m_maxAscent, m_height - m_minHeight);
+					return;
+				}
+				if (upMask == 0) {
+					// The walk only falls within this word
+					m_height -= nDown;
+					m_minHeight = std::min(m_minHeight, m_height);
+					m_maxDescent = std::max(m_maxDescent, m_maxHeight - m_height);
+					return;
+				}
+
+				for (size_t shift = 0; shift < BitPlanes::WORD_BITS; shift += 8) {
+					auto upByte = (upMask >> shift) & 0xFF;
+					auto downByte = (downMask >> shift) & 0xFF;
+					if ((upByte | downByte) == 0) {
+						continue;
+					}
+
+					const auto& summary = m_summaryTable[(upByte << 8) | downByte];
+					m_maxDescent = std::max(m_maxDescent, static_cast<long>(summary.maxDescent));
+					m_maxDescent = std::max(m_maxDescent, m_maxHeight - (m_height + summary.minPrefix));
+
+					// The mirrored byte (up and down swapped) holds the inner ascent of this one
+					const auto& mirroredSummary = m_summaryTable[(downByte << 8) | upByte];
+					m_maxAscent = std::max(m_maxAscent, static_cast<long>(mirroredSummary.maxDescent));
+					m_maxAscent = std::max(m_maxAscent, (m_height + summary.maxPrefix) - m_minHeight);
+
+					m_maxHeight = std::max(m_maxHeight, m_height + summary.maxPrefix);
+					m_minHeight = std::min(m_minHeight, m_height + summary.minPrefix);
+					m_height += summary.netHeight;
+				}
+			}
+
+			MirroredWalkSummary summary() const {
+				return MirroredWalkSummary{ m_upSteps, m_downSteps, m_maxDescent, m_maxAscent };
+			}
+
+		private:
+			const ByteSummaryTable& m_summaryTable = byteSummaryTable();
+
+			long m_upSteps = 0;
+			long m_downSteps = 0;
+			long m_height = 0;
+			long m_maxHeight = 0;
+			long m_minHeight = 0;
+			long m_maxDescent = 0;
+			long m_maxAscent = 0;
+		};
+	}   // unnamed
+
+	RandomWalkSummary computeSteps(const BitPlanes& child,
+		const BitPlanes& dad,
+		const BitPlanes& mum) {
+		return computeMirroredSteps(child, dad, mum).forward();
+	}
+
+	MirroredWalkSummary computeMirroredSteps(const BitPlanes& child,
+		const BitPlanes& dad,
+		const BitPlanes& mum) {
+		WalkState walk;
+
+		auto nWords = child.wordCount();
+		for (size_t wordIdx = 0; wordIdx < nWords; wordIdx++) {
+			auto childLow = child.lowBits[wordIdx];
+			auto childHigh = child.highBits[wordIdx];
+			auto nonGap = child.nonGapMask[wordIdx] & dad.nonGapMask[wordIdx] & mum.nonGapMask[wordIdx];
+			auto dadMatches = ~((dad.lowBits[wordIdx] ^ childLow) | (dad.highBits[wordIdx] ^ childHigh));
+			auto mumMatches = ~((mum.lowBits[wordIdx] ^ childLow) | (mum.highBits[wordIdx] ^ childHigh));
+
+			walk.advance(nonGap & dadMatches & ~mumMatches, nonGap & ~dadMatches & mumMatches);
+		}
+
+		return walk.summary();
+	}
+
+	MirroredWalkSummary computeMirroredSteps(const BitPlanes& child,
+		const ParentPairIndex& parents) {
+		WalkState walk;
+
+		for (const auto& word : parents.words) {
+			auto childLow = child.lowBits[word.wordIdx];
+			auto childHigh = child.highBits[word.wordIdx];
+			auto sites = word.siteMask & child.nonGapMask[word.wordIdx];
+
+			// The parents differ at every informative site, so the child matches at most one of them
+			auto dadMatches = ~((word.dadLowBits ^ childLow) | (word.dadHighBits ^ childHigh));
+			auto mumMatches = ~((word.mumLowBits ^ childLow) | (word.mumHighBits ^ childHigh));
+
+			walk.advance(sites & dadMatches, sites & mumMatches);
+		}
+
+		return walk.summary();
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "BitPlanes.h"
+#include "ParentPairIndex.h"
+
+/**
+ * The summary of the random walk of a triplet (child, dad, mum): m up-steps (the child
+ * matches the dad only), n down-steps (the child matches the mum only) and the maximum
+ * descent k of the walk.
+ */
+struct RandomWalkSummary {
+	long upSteps;
+	long downSteps;
+	long maxDescent;
+};
+
+/**
+ * The summary of the walks of both orientations of a triplet: (child, dad, mum) and its
+ * mirror (child, mum, dad). The mirrored walk swaps the up- and down-steps, so its maximum
+ * descent is the maximum ascent of the forward walk.
+ */
+struct MirroredWalkSummary {
+	long upSteps;
+	long downSteps;
+	long maxDescent;
+	long maxAscent;
+
+	RandomWalkSummary forward() const {
+		return RandomWalkSummary{ upSteps, downSteps, maxDescent };
+	}
+
+	RandomWalkSummary mirrored() const {
+		return RandomWalkSummary{ downSteps, upSteps, maxAscent };
+	}
+};
+
+namespace TripletKernel {
+
+	/**
+	 * Compute m, n and k of the triplet on the bit-packed active columns, 64 sites per word.
+	 * The result is exactly the same as the one of the site-by-site walk.
+	 */
+	RandomWalkSummary computeSteps(const BitPlanes& child,
+		const BitPlanes& dad,
+		const BitPlanes& mum);
+
+	/**
+	 * Compute the summaries of (child, dad, mum) and (child, mum, dad) in a single scan.
+	 */
+	MirroredWalkSummary computeMirroredSteps(const BitPlanes& child,
+		const BitPlanes& dad,
+		const BitPlanes& mum);
+
+	/**
+	 * Same as above, but only the informative sites of the parent pair are visited,
+	 * so the cost is proportional to the distance between the parents.
+	 */
+	MirroredWalkSummary computeMirroredSteps(const BitPlanes& child,
+		const ParentPairIndex& parents);
+}
@@ -1,23 +1,111 @@
 #include "TripletPool.h"
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 
-#include "TripletPool.h"
-
 #include "../app/UserSettings.h"
 
+namespace {
+	bool ranksBefore(const TripletRecord& lhs, const TripletRecord& rhs) {
+		return lhs.ranksBefore(rhs);
+	}
+}
+
 TripletPool::TripletPool()
-	: savedTriplets(), m_freeTriplets(), m_storageMode(StorageMode::BestTriplet),
-	m_longestMinRecLength(0) {
+	: savedTriplets(), m_children(nullptr), m_parents(nullptr), m_bestTriplets(nullptr), m_freeTriplets(),
+	m_storageMode(StorageMode::BestTriplet), m_topTripletCount(1),
+	m_correction(StatisticalUtils::Correction::of<StatisticalUtils::DunnSidakCorrection>()),
+	m_maxRecords(0), m_recordCount(0), m_longestMinRecLength(0) {
+}
+
+TripletPool::~TripletPool() {
+	TripletSpill::removeRuns(m_spilledRuns);
+}
+
+void TripletPool::discardSpilledRuns() {
+	TripletSpill::removeRuns(m_spilledRuns);
+}
+
+void TripletPool::setSequences(const std::vector<SequencePtr>& children, const std::vector<SequencePtr>& parents) {
+	m_children = &children;
+	m_parents = &parents;
+	savedTriplets.assign(children.size(), {});
+	m_breakPointTriplets.assign(children.size(), {});
+	if (m_storageMode == StorageMode::SummaryOnly) {
+		m_recombinantCounts.assign(children.size(), 0);
+	}
+}
+
+void TripletPool::shareBestTriplets(BestTripletTable& bestTriplets) {
+	m_bestTriplets = &bestTriplets;
 }
 
 void TripletPool::setStorageMode(TripletPool::StorageMode newStorageMode) {
 	m_storageMode = newStorageMode;
 }
 
-TripletPtr TripletPool::newTriplet(const SequencePtr& child,
-	const SequencePtr& dad,
-	const SequencePtr& mum) {
+void TripletPool::setTopTripletCount(size_t topTripletCount) {
+	assert(topTripletCount > 0);
+	m_topTripletCount = topTripletCount;
+}
+
+void TripletPool::setCorrection(const StatisticalUtils::Correction& correction) {
+	m_correction = correction;
+}
+
+void TripletPool::setSpilling(const std::filesystem::path& directory, size_t maxRecords) {
+	assert(m_storageMode == StorageMode::AllTriplets && maxRecords > 0);
+	m_spillDirectory = directory;
+	m_maxRecords = maxRecords;
+	m_recordCount = 0;
+	m_recombinantCounts.assign(savedTriplets.size(), 0);
+}
+
+void TripletPool::spill() {
+	std::vector<TripletRecord> run;
+	run.reserve(m_recordCount);
+	for (size_t childIdx = 0; childIdx < savedTriplets.size(); childIdx++) {
+		auto& childTriplets = savedTriplets[childIdx];
+		std::sort(childTriplets.begin(), childTriplets.end(),
+			[](const TripletRecord& lhs, const TripletRecord& rhs) { return lhs.precedes(rhs); });
+		run.insert(run.end(), childTriplets.begin(), childTriplets.end());
+		m_recombinantCounts[childIdx] += childTriplets.size();
+		// Give the memory back, not only the records
+		std::vector<TripletRecord>().swap(childTriplets);
+	}
+	m_recordCount = 0;
+
+	if (!run.empty()) {
+		m_spilledRuns.push_back(TripletSpill::writeRun(m_spillDirectory, run));
+	}
+}
+
+void TripletPool::adoptSpilledRuns(std::vector<TripletPool>& threadPools) {
+	m_recombinantCounts.assign(savedTriplets.size(), 0);
+	for (auto& threadPool : threadPools) {
+		if (threadPool.m_maxRecords == 0) {
+			continue;
+		}
+		// The triplets are read back by batches of the budget of a thread
+		m_maxRecords = std::max(m_maxRecords, threadPool.m_maxRecords);
+		threadPool.spill();
+		for (size_t childIdx = 0; childIdx < savedTriplets.size(); childIdx++) {
+			m_recombinantCounts[childIdx] += threadPool.m_recombinantCounts[childIdx];
+		}
+		m_spilledRuns.insert(m_spilledRuns.end(), threadPool.m_spilledRuns.begin(), threadPool.m_spilledRuns.end());
+		threadPool.m_spilledRuns.clear();
+	}
+}
+
+bool TripletPool::hasTriplets(const size_t& childIdx) const {
+	if (isSpilled()) {
+		return m_recombinantCounts[childIdx] != 0;
+	}
+	return !savedTriplets[childIdx].empty();
+}
+
+TripletPtr TripletPool::acquireTriplet() {
 	TripletPtr triplet;
 	if (!m_freeTriplets.empty()) {
 		triplet = m_freeTriplets.top();
@@ -26,89 +114,277 @@ TripletPtr TripletPool::newTriplet(const SequencePtr& child,
 	else {
 		triplet = Triplet::create();
 	}
+	return triplet;
+}
 
+TripletPtr TripletPool::newTriplet(const SequencePtr& child,
+	const SequencePtr& dad,
+	const SequencePtr& mum) {
+	auto triplet = acquireTriplet();
 	triplet->reassign(child, dad, mum);
 	return triplet;
 }
 
-void TripletPool::saveTriplet(const SequencePtr& child, const TripletPtr& newTriplet) {
-	if (savedTriplets.find(child) != savedTriplets.end()) {
-		switch (m_storageMode)
-		{
-		case TripletPool::StorageMode::BestTriplet:
-		{
-			auto currentBestTriplet = savedTriplets[child][0];
-			auto worseTriplet = newTriplet;
-			if (newTriplet->statisticallyBetter(*currentBestTriplet)) {
-				savedTriplets[child][0] = newTriplet;
-				worseTriplet = currentBestTriplet;
-			}
-			freeTriplet(worseTriplet);
-			break;
+TripletPtr TripletPool::newTriplet(const TripletRecord& record) {
+	auto triplet = acquireTriplet();
+	assignRecord(*triplet, record);
+	return triplet;
+}
+
+void TripletPool::assignRecord(Triplet& triplet, const TripletRecord& record) const {
+	assert(m_children != nullptr && m_parents != nullptr);
+	triplet.reassign((*m_children)[record.childIdx], (*m_parents)[record.dadIdx], (*m_parents)[record.mumIdx], record);
+}
+
+void TripletPool::saveTriplet(const TripletRecord& record) {
+	switch (m_storageMode)
+	{
+	case TripletPool::StorageMode::BestTriplet:
+		saveTriplet<StorageMode::BestTriplet>(record);
+		break;
+	case TripletPool::StorageMode::AllTriplets:
+		saveTriplet<StorageMode::AllTriplets>(record);
+		break;
+	case TripletPool::StorageMode::TopK:
+		saveTriplet<StorageMode::TopK>(record);
+		break;
+	case TripletPool::StorageMode::SummaryOnly:
+		saveTriplet<StorageMode::SummaryOnly>(record);
+		break;
+	default:
+		break;
+	}
+}
+
+template <TripletPool::StorageMode Mode>
+void TripletPool::saveTriplet(const TripletRecord& record) {
+	assert(record.childIdx < savedTriplets.size());
+	auto& childTriplets = savedTriplets[record.childIdx];
+
+	if constexpr (Mode == StorageMode::SummaryOnly) {
+		m_recombinantCounts[record.childIdx]++;
+	}
+
+	if constexpr (Mode == StorageMode::BestTriplet || Mode == StorageMode::SummaryOnly) {
+		if (m_bestTriplets != nullptr && !m_bestTriplets->offer(record)) {
+			// Another thread holds a better triplet of the child
+			return;
+		}
+		// The slot of the child keeps the best triplet of this pool
+		if (childTriplets.empty()) {
+			childTriplets.push_back(record);
 		}
-		case TripletPool::StorageMode::AllTriplets:
-			savedTriplets[child].push_back(newTriplet);
-			break;
-		default:
-			break;
+		else if (record.ranksBefore(childTriplets[0])) {
+			childTriplets[0] = record;
+		}
+	}
+	else if constexpr (Mode == StorageMode::TopK) {
+		// A heap with the worst of the kept triplets on top
+		if (childTriplets.size() < m_topTripletCount) {
+			childTriplets.push_back(record);
+			std::push_heap(childTriplets.begin(), childTriplets.end(), ranksBefore);
+		}
+		else if (record.ranksBefore(childTriplets.front())) {
+			std::pop_heap(childTriplets.begin(), childTriplets.end(), ranksBefore);
+			childTriplets.back() = record;
+			std::push_heap(childTriplets.begin(), childTriplets.end(), ranksBefore);
 		}
 	}
 	else {
-		savedTriplets[child] = std::vector<TripletPtr>{ newTriplet };
+		childTriplets.push_back(record);
+		if (m_maxRecords != 0 && ++m_recordCount >= m_maxRecords) {
+			spill();
+		}
 	}
 }
 
+template void TripletPool::saveTriplet<TripletPool::StorageMode::BestTriplet>(const TripletRecord&);
+template void TripletPool::saveTriplet<TripletPool::StorageMode::AllTriplets>(const TripletRecord&);
+template void TripletPool::saveTriplet<TripletPool::StorageMode::TopK>(const TripletRecord&);
+template void TripletPool::saveTriplet<TripletPool::StorageMode::SummaryOnly>(const TripletRecord&);
+
 void TripletPool::freeTriplet(TripletPtr& triplet) {
 	m_freeTriplets.push(triplet);
 	triplet.reset();
 }
 
-void TripletPool::writeToFile(TextFile* fileRecombinants, const std::string& separator) const {
+void TripletPool::mergeChild(const size_t& childIdx, const std::vector<TripletPool>& threadPools) {
+	auto& childTriplets = savedTriplets[childIdx];
+	childTriplets.clear();
+
+	if (m_storageMode == StorageMode::BestTriplet || m_storageMode == StorageMode::SummaryOnly) {
+		for (const auto& threadPool : threadPools) {
+			for (const auto& record : threadPool.savedTriplets[childIdx]) {
+				if (childTriplets.empty()) {
+					childTriplets.push_back(record);
+				}
+				else if (record.ranksBefore(childTriplets[0])) {
+					childTriplets[0] = record;
+				}
+			}
+		}
+		if (m_storageMode == StorageMode::SummaryOnly) {
+			m_recombinantCounts[childIdx] = 0;
+			for (const auto& threadPool : threadPools) {
+				m_recombinantCounts[childIdx] += threadPool.m_recombinantCounts[childIdx];
+			}
+		}
+		return;
+	}
+
+	for (const auto& threadPool : threadPools) {
+		const auto& threadTriplets = threadPool.savedTriplets[childIdx];
+		childTriplets.insert(childTriplets.end(), threadTriplets.begin(), threadTriplets.end());
+	}
+
+	if (m_storageMode == StorageMode::TopK) {
+		// The order is total, so the kept triplets do not depend on how the work was split
+		std::sort(childTriplets.begin(), childTriplets.end(), ranksBefore);
+		if (childTriplets.size() > m_topTripletCount) {
+			childTriplets.resize(m_topTripletCount);
+		}
+	}
+	else {
+		std::sort(childTriplets.begin(), childTriplets.end(),
+			[](const TripletRecord& lhs, const TripletRecord& rhs) { return lhs.precedes(rhs); });
+	}
+}
+
+void TripletPool::writeToFile(TextFile* fileRecombinants, const std::function<void()>& searchBreakPoints,
+	const std::string& separator) {
 	if (fileRecombinants == nullptr) {
 		return;
 	}
 
+	// A summary starts with the number of recombinant triplets of the child, then its best triplet
+	bool isSummary = m_storageMode == StorageMode::SummaryOnly;
+	std::string summaryHeader = isSummary ? "Recombinant_Triplets" + separator : "";
+
 	if (UserSettings::instance().simplifiedOutput) {
-		fileRecombinants->writeLine(
+		fileRecombinants->writeLine(summaryHeader +
 			"Parent1" + separator + "Parent2" + separator + "Child" + separator + "log10(p)" + separator +
-			"Dunn_Sidak_Corr(p)" + separator +
+			m_correction.columnName + separator +
 			"Min_Rec_Length" + separator + "Breakpoints"
 		);
 	}
 	else {
-		fileRecombinants->writeLine(
+		fileRecombinants->writeLine(summaryHeader +
 			"Parent1" + separator + "Parent2" + separator + "Child" + separator +
 			"m" + separator + "n" + separator + "k" + separator +
 			"p" + separator + "HS?" + separator + "log10(p)" + separator +
-			"Dunn_Sidak_Corr(p)" + separator + "DS(p)" + separator +
+			m_correction.columnName + separator + m_correction.shortColumnName + separator +
 			"Min_Rec_Length" + separator + "Breakpoints"
 		);
 	}
 
 
-	for (const auto& dataPair : savedTriplets) {
-		for (const auto& triplet : dataPair.second) {
-			fileRecombinants->writeLine(triplet->toString(separator));
+	if (isSpilled()) {
+		TripletRunMerger merger(m_spilledRuns);
+		std::vector<size_t> batchChildren;
+		while (loadSpilledBatch(merger, batchChildren)) {
+			if (searchBreakPoints) {
+				searchBreakPoints();
+			}
+			for (const auto& childIdx : batchChildren) {
+				writeChild(fileRecombinants, childIdx, "", separator);
+			}
 		}
+		fileRecombinants->close();
+		return;
+	}
+
+	for (size_t childIdx = 0; childIdx < savedTriplets.size(); childIdx++) {
+		std::string summary = isSummary ? std::to_string(m_recombinantCounts[childIdx]) + separator : "";
+		writeChild(fileRecombinants, childIdx, summary, separator);
 	}
 
 	fileRecombinants->close();
 }
 
-void TripletPool::seekBreakPointPairs(const SequencePtr& child) {
-	if (savedTriplets.find(child) == savedTriplets.end()) {
+bool TripletPool::loadSpilledBatch(TripletRunMerger& merger, std::vector<size_t>& batchChildren) {
+	for (const auto& childIdx : batchChildren) {
+		std::vector<TripletRecord>().swap(savedTriplets[childIdx]);
+		std::vector<TripletPtr>().swap(m_breakPointTriplets[childIdx]);
+	}
+	batchChildren.clear();
+
+	// A child is never split, so a batch may go over the budget by the triplets of its last child
+	size_t recordCount = 0;
+	std::vector<TripletRecord> records;
+	while (recordCount < m_maxRecords && merger.nextChild(records)) {
+		auto childIdx = records.front().childIdx;
+		recordCount += records.size();
+		savedTriplets[childIdx].swap(records);
+		batchChildren.push_back(childIdx);
+	}
+	return !batchChildren.empty();
+}
+
+void TripletPool::writeChild(TextFile* fileRecombinants, const size_t& childIdx, const std::string& summary,
+	const std::string& separator) {
+	if (!m_breakPointTriplets[childIdx].empty()) {
+		for (const auto& triplet : m_breakPointTriplets[childIdx]) {
+			fileRecombinants->writeLine(summary + triplet->toString(m_correction, separator));
+		}
 		return;
 	}
 
-	for (const auto& triplet : savedTriplets[child]) {
+	for (const auto& record : savedTriplets[childIdx]) {
+		auto triplet = newTriplet(record);
+		fileRecombinants->writeLine(summary + triplet->toString(m_correction, separator));
+		freeTriplet(triplet);
+	}
+}
+
+size_t TripletPool::prepareBreakPointSearch() {
+	m_breakPointBlocks.clear();
+	for (size_t childIdx = 0; childIdx < savedTriplets.size(); childIdx++) {
+		auto tripletCount = savedTriplets[childIdx].size();
+		m_breakPointTriplets[childIdx].assign(tripletCount, nullptr);
+		for (size_t first = 0; first < tripletCount; first += BREAK_POINT_BLOCK_SIZE) {
+			m_breakPointBlocks.push_back({ childIdx, first, std::min(first + BREAK_POINT_BLOCK_SIZE, tripletCount) });
+		}
+	}
+	return m_breakPointBlocks.size();
+}
+
+void TripletPool::seekBreakPointPairs(const size_t& blockIdx) {
+	// The free triplets are not shared between threads, every triplet of the block is a new one
+	const auto& block = m_breakPointBlocks[blockIdx];
+	const auto& records = savedTriplets[block.childIdx];
+	auto& triplets = m_breakPointTriplets[block.childIdx];
+	for (auto tripletIdx = block.first; tripletIdx < block.last; tripletIdx++) {
+		auto triplet = Triplet::create();
+		assignRecord(*triplet, records[tripletIdx]);
 		triplet->seekBreakPointPairs();
-		if (m_longestMinRecLength < triplet->m_minRecombinantLength) {
-			m_longestMinRecLength = triplet->m_minRecombinantLength;
+		triplets[tripletIdx] = triplet;
+	}
+}
+
+void TripletPool::finishBreakPointSearch() {
+	for (const auto& triplets : m_breakPointTriplets) {
+		for (const auto& triplet : triplets) {
+			if (m_longestMinRecLength < triplet->m_minRecombinantLength) {
+				m_longestMinRecLength = triplet->m_minRecombinantLength;
+			}
+			markLongRecombinant(*triplet);
 		}
 	}
+	std::vector<TripletBlock>().swap(m_breakPointBlocks);
+}
+
+void TripletPool::markLongRecombinant(const Triplet& triplet) {
+	if (triplet.isLongRecombinant()
+		&& triplet.m_child->getRecombinantType() == Sequence::RecombinantType::Short) {
+		triplet.m_child->setRecombinantType(Sequence::RecombinantType::Long);
+	}
 }
 
 size_t TripletPool::getLongestMinRecLength() const {
 	return m_longestMinRecLength;
 }
 
+size_t TripletPool::getRecombinantCount(const size_t& childIdx) const {
+	return m_recombinantCounts[childIdx];
+}
+
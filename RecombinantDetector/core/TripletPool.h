@@ -1,44 +1,174 @@
 #pragma once
-#include <map>
+#include <filesystem>
+#include <functional>
 #include <vector>
 #include <stack>
 
+#include "BestTripletTable.h"
 #include "Triplet.h"
+#include "TripletRecord.h"
+#include "TripletSpill.h"
 #include "Sequence.h"
 
 #include "../app/TextFile.h"
 
+/**
+ * Keeps the recombinant triplets of a run as compact records, in a table indexed by the
+ * active child index.
+ * A full Triplet is rebuilt from a record for the breakpoint search, after which it is kept
+ * with its breakpoints but without its random walk, and for the output.
+ */
 class TripletPool {
 public:
+	/* The triplets kept for every child: the best one, all of them, the best ones up to
+	the top count, or the best one and the number of recombinant triplets. Memory is constant
+	per child in every mode but AllTriplets */
 	enum class StorageMode {
 		BestTriplet,
-		AllTriplets
+		AllTriplets,
+		TopK,
+		SummaryOnly
 	};
 
 	TripletPool();
 
+	TripletPool(const TripletPool&) = delete;
+	TripletPool& operator=(const TripletPool&) = delete;
+
+	// Removes the spilled runs
+	~TripletPool();
+
+	// The active lists the indices of the records refer to, they must outlive the pool
+	void setSequences(const std::vector<SequencePtr>& children, const std::vector<SequencePtr>& parents);
+
+	// In the BestTriplet and SummaryOnly modes, drop the triplets worse than the best ones of the other pools sharing the table
+	void shareBestTriplets(BestTripletTable& bestTriplets);
+
+	// The number of triplets kept for a child in the TopK mode
+	void setTopTripletCount(size_t topTripletCount);
+
+	// The correction of the p-values written by writeToFile, Dunn-Sidak by default
+	void setCorrection(const StatisticalUtils::Correction& correction);
+
+	/**
+	 * In the AllTriplets mode, write the saved triplets to a sorted run in the directory each time
+	 * there are maxRecords of them in memory. Must be called after setSequences().
+	 */
+	void setSpilling(const std::filesystem::path& directory, size_t maxRecords);
+
+	bool isSpilled() const { return !m_spilledRuns.empty(); };
+
+	// Remove the spilled runs now, when the program exits without destroying the pool
+	void discardSpilledRuns();
+
+	/**
+	 * Take over the triplets of the detection threads when some of them were spilled: the
+	 * remaining triplets are spilled too, then breakpoints and the output stream through the runs.
+	 */
+	void adoptSpilledRuns(std::vector<TripletPool>& threadPools);
+
+	bool hasTriplets(const size_t& childIdx) const;
+
 	TripletPtr newTriplet(const SequencePtr& child,
 		const SequencePtr& dad,
 		const SequencePtr& mum);
 
-	void saveTriplet(const SequencePtr& child, const TripletPtr& newTriplet);
+	// Rebuild the triplet of a record, it should be returned with freeTriplet()
+	TripletPtr newTriplet(const TripletRecord& record);
+
+	void saveTriplet(const TripletRecord& record);
+
+	// Same as above with the storage mode fixed at compile time, it must match the pool's mode
+	template <StorageMode Mode>
+	void saveTriplet(const TripletRecord& record);
 
 	void freeTriplet(TripletPtr& triplet);
 
+	/**
+	 * Collect the triplets of a child saved by the pools of the detection threads, ordered by
+	 * (dad, mum). Different children can be merged concurrently.
+	 */
+	void mergeChild(const size_t& childIdx, const std::vector<TripletPool>& threadPools);
+
 	void setStorageMode(StorageMode newStorageMode);
 
-	void writeToFile(TextFile* fileRecombinants, const std::string& separator = ",") const;
+	/**
+	 * Write the triplets. The spilled ones are read back a batch of children at a time, and
+	 * searchBreakPoints is called for every batch: the batch is what prepareBreakPointSearch() splits.
+	 */
+	void writeToFile(TextFile* fileRecombinants, const std::function<void()>& searchBreakPoints = nullptr,
+		const std::string& separator = ",");
+
+	/**
+	 * Split the saved triplets into blocks for the breakpoint search and return their number.
+	 * Spilled triplets are searched by batches while they are written, see writeToFile().
+	 */
+	size_t prepareBreakPointSearch();
+
+	// Search the breakpoints of the triplets of a block, different blocks can be searched concurrently
+	void seekBreakPointPairs(const size_t& blockIdx);
 
-	void seekBreakPointPairs(const SequencePtr& child);
+	// Once all the blocks are searched, reduce the longest segment and mark the long recombinants
+	void finishBreakPointSearch();
 
 	size_t getLongestMinRecLength() const;
 
-	std::map<SequencePtr, std::vector<TripletPtr>> savedTriplets;
+	// The number of recombinant triplets of a child in the SummaryOnly mode
+	size_t getRecombinantCount(const size_t& childIdx) const;
+
+	// The saved triplets of every active child, best first in the TopK mode
+	std::vector<std::vector<TripletRecord>> savedTriplets;
 
 private:
+	static const size_t BREAK_POINT_BLOCK_SIZE = 16;
+
+	// A range of the saved triplets of a child
+	struct TripletBlock {
+		size_t childIdx;
+		size_t first;
+		size_t last;
+	};
+
+	TripletPtr acquireTriplet();
+
+	void assignRecord(Triplet& triplet, const TripletRecord& record) const;
+
+	void markLongRecombinant(const Triplet& triplet);
+
+	void spill();
+
+	/**
+	 * Replace the previous batch of children with the next children of the spilled runs, up to
+	 * the memory budget of a detection thread. False after the last child.
+	 */
+	bool loadSpilledBatch(TripletRunMerger& merger, std::vector<size_t>& batchChildren);
+
+	// Write the triplets of a child, with their breakpoints if they were searched
+	void writeChild(TextFile* fileRecombinants, const size_t& childIdx, const std::string& summary,
+		const std::string& separator);
+
+	const std::vector<SequencePtr>* m_children;
+	const std::vector<SequencePtr>* m_parents;
+
+	BestTripletTable* m_bestTriplets;
+
+	// The triplets rebuilt by seekBreakPointPairs, in the order of the records of the child
+	std::vector<std::vector<TripletPtr>> m_breakPointTriplets;
+	std::vector<TripletBlock> m_breakPointBlocks;
+
 	std::stack<TripletPtr> m_freeTriplets;
 
 	StorageMode m_storageMode;
+	size_t m_topTripletCount;
+	StatisticalUtils::Correction m_correction;
+
+	// Only in the SummaryOnly mode and when spilling
+	std::vector<size_t> m_recombinantCounts;
+
+	std::filesystem::path m_spillDirectory;
+	size_t m_maxRecords;
+	size_t m_recordCount;
+	std::vector<std::filesystem::path> m_spilledRuns;
 
 	size_t m_longestMinRecLength;
 };
@@ -0,0 +1,38 @@
+#include "TripletRecord.h"
+
+#include <cassert>
+#include <limits>
+
+#include "Triplet.h"
+#include "../utils/numeric_types.h"
+
+TripletRecord TripletRecord::evaluate(const size_t& childIdx, const size_t& dadIdx, const size_t& mumIdx,
+	const RandomWalkSummary& summary) {
+	assert(childIdx <= std::numeric_limits<uint32_t>::max());
+	assert(dadIdx <= std::numeric_limits<uint32_t>::max() && mumIdx <= std::numeric_limits<uint32_t>::max());
+	assert(summary.maxDescent < (1L << 30));
+
+	TripletRecord record;
+	record.childIdx = static_cast<uint32_t>(childIdx);
+	record.dadIdx = static_cast<uint32_t>(dadIdx);
+	record.mumIdx = static_cast<uint32_t>(mumIdx);
+	record.upSteps = static_cast<int32_t>(summary.upSteps);
+	record.downSteps = static_cast<int32_t>(summary.downSteps);
+	record.maxDescent = static_cast<int32_t>(summary.maxDescent);
+
+	bool isExact = false;
+	record.pValue = Triplet::pValueOf(summary, isExact);
+	record.isApproximate = !isExact;
+	return record;
+}
+
+bool TripletRecord::hasPVal() const {
+	return isSet(pValue);
+}
+
+bool TripletRecord::statisticallyBetter(const TripletRecord& another) const {
+	if (hasPVal() && !another.hasPVal()) {
+		return true;
+	}
+	return hasPVal() && another.hasPVal() && pValue < another.pValue;
+}
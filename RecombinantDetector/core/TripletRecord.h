@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "TripletKernel.h"
+
+/**
+ * A triplet as it is kept in the results: the indices of its sequences in the active child
+ * and parent lists, m, n, k and the p-value, in 32 bytes.
+ * The full Triplet, with its random walk, is rebuilt from a record only for the breakpoint
+ * search and the output (see TripletPool).
+ */
+struct TripletRecord {
+	uint32_t childIdx;
+	uint32_t dadIdx;
+	uint32_t mumIdx;
+	int32_t upSteps;
+	int32_t downSteps;
+	// k never exceeds the active length, so 31 bits hold it and the last one the kind of the p-value
+	int32_t maxDescent : 31;
+	uint32_t isApproximate : 1;
+	// Not set if the p-value can be neither computed exactly nor approximated
+	double pValue;
+
+	// Compute the p-value of the triplet with the P-value table
+	static TripletRecord evaluate(const size_t& childIdx, const size_t& dadIdx, const size_t& mumIdx,
+		const RandomWalkSummary& summary);
+
+	bool hasPVal() const;
+
+	RandomWalkSummary summary() const {
+		return RandomWalkSummary{ upSteps, downSteps, maxDescent };
+	};
+
+	/**
+	 * Same as Triplet::statisticallyBetter for triplets without breakpoints: the smaller p-value
+	 * is better, the recombinant lengths are not known yet.
+	 */
+	bool statisticallyBetter(const TripletRecord& another) const;
+
+	/**
+	 * Check if this triplet comes before another one of the same child in the
+	 * (dad, mum) enumeration order. Used to break ties deterministically.
+	 */
+	bool precedes(const TripletRecord& another) const {
+		if (dadIdx != another.dadIdx) {
+			return dadIdx < another.dadIdx;
+		}
+		return mumIdx < another.mumIdx;
+	};
+
+	/**
+	 * The order of the triplets of a child in the BestTriplet mode: statistically better first,
+	 * equally good triplets by (dad, mum), so the best one does not depend on the evaluation order.
+	 */
+	bool ranksBefore(const TripletRecord& another) const {
+		return statisticallyBetter(another)
+			|| (!another.statisticallyBetter(*this) && precedes(another));
+	};
+};
+
+// The records are spilled to disk as they are, and the memory limits are computed with their size
+static_assert(sizeof(TripletRecord) == 32, "A triplet record must take 32 bytes");
@@ -0,0 +1,119 @@
+#include "TripletSpill.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <type_traits>
+
+#include "../app/App.h"
+
+static_assert(std::is_trivially_copyable<TripletRecord>::value, "Triplet records are written to the runs as raw bytes");
+
+namespace {
+	// Distinguishes the runs of the processes sharing a directory
+	std::string processToken() {
+		static const std::string token = std::to_string(std::random_device{}())
+			+ "-" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+		return token;
+	}
+
+	std::atomic<size_t> runCounter{ 0 };
+
+	void failOn(const std::filesystem::path& run) {
+		App::instance() << "Cannot write or read the spilled triplets file \"" << run.string() << "\".\n";
+		App::instance().showError(true, true); // show error & exit
+	}
+}
+
+bool TripletSpill::runOrder(const TripletRecord& lhs, const TripletRecord& rhs) {
+	if (lhs.childIdx != rhs.childIdx) {
+		return lhs.childIdx < rhs.childIdx;
+	}
+	return lhs.precedes(rhs);
+}
+
+std::filesystem::path TripletSpill::writeRun(const std::filesystem::path& directory, const std::vector<TripletRecord>& records) {
+	auto run = directory / ("RecDetector-triplets-" + processToken() + "-" + std::to_string(runCounter++) + ".bin");
+
+	std::ofstream stream(run, std::ios::binary | std::ios::trunc);
+	stream.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TripletRecord));
+	stream.close();
+	if (!stream) {
+		failOn(run);
+	}
+	return run;
+}
+
+void TripletSpill::removeRuns(std::vector<std::filesystem::path>& runs) {
+	for (const auto& run : runs) {
+		std::error_code error;
+		std::filesystem::remove(run, error);
+	}
+	runs.clear();
+}
+
+TripletRunMerger::RunReader::RunReader(const std::filesystem::path& run)
+	: m_stream(run, std::ios::binary), m_position(0) {
+	if (!m_stream) {
+		failOn(run);
+	}
+	fill();
+}
+
+void TripletRunMerger::RunReader::advance() {
+	m_position++;
+	if (m_position == m_buffer.size()) {
+		fill();
+	}
+}
+
+void TripletRunMerger::RunReader::fill() {
+	m_buffer.resize(BUFFER_SIZE);
+	m_stream.read(reinterpret_cast<char*>(m_buffer.data()), BUFFER_SIZE * sizeof(TripletRecord));
+	m_buffer.resize(static_cast<size_t>(m_stream.gcount()) / sizeof(TripletRecord));
+	m_position = 0;
+}
+
+TripletRunMerger::TripletRunMerger(const std::vector<std::filesystem::path>& runs) {
+	for (const auto& run : runs) {
+		m_readers.push_back(std::make_unique<RunReader>(run));
+		if (!m_readers.back()->isDone()) {
+			m_heap.push_back(m_readers.size() - 1);
+		}
+	}
+	std::make_heap(m_heap.begin(), m_heap.end(),
+		[this](const size_t& lhs, const size_t& rhs) { return readerAfter(lhs, rhs); });
+}
+
+bool TripletRunMerger::readerAfter(const size_t& lhs, const size_t& rhs) const {
+	return TripletSpill::runOrder(m_readers[rhs]->current(), m_readers[lhs]->current());
+}
+
+bool TripletRunMerger::nextChild(std::vector<TripletRecord>& records) {
+	records.clear();
+	if (m_heap.empty()) {
+		return false;
+	}
+
+	auto readerAfter = [this](const size_t& lhs, const size_t& rhs) { return this->readerAfter(lhs, rhs); };
+	auto childIdx = m_readers[m_heap.front()]->current().childIdx;
+	while (!m_heap.empty()) {
+		auto& reader = *m_readers[m_heap.front()];
+		if (reader.current().childIdx != childIdx) {
+			break;
+		}
+		records.push_back(reader.current());
+
+		std::pop_heap(m_heap.begin(), m_heap.end(), readerAfter);
+		reader.advance();
+		if (reader.isDone()) {
+			m_heap.pop_back();
+		}
+		else {
+			std::push_heap(m_heap.begin(), m_heap.end(), readerAfter);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "TripletRecord.h"
+
+/**
+ * Sorted runs of triplet records written to temporary files when the AllTriplets mode goes over
+ * its memory budget. A run is the raw records ordered by child, then by (dad, mum).
+ */
+namespace TripletSpill {
+	bool runOrder(const TripletRecord& lhs, const TripletRecord& rhs);
+
+	// Write records that are already in the run order to a new file of the directory
+	std::filesystem::path writeRun(const std::filesystem::path& directory, const std::vector<TripletRecord>& records);
+
+	void removeRuns(std::vector<std::filesystem::path>& runs);
+}
+
+/**
+ * Reads the runs back with a k-way merge, one child at a time, so only the records of a single
+ * child and a small buffer per run are in memory.
+ */
+class TripletRunMerger {
+public:
+	explicit TripletRunMerger(const std::vector<std::filesystem::path>& runs);
+
+	// The records of the next child with triplets, ordered by (dad, mum), false after the last child
+	bool nextChild(std::vector<TripletRecord>& records);
+
+private:
+	class RunReader {
+	public:
+		static const size_t BUFFER_SIZE = 4096;
+
+		explicit RunReader(const std::filesystem::path& run);
+
+		bool isDone() const { return m_position == m_buffer.size(); };
+		const TripletRecord& current() const { return m_buffer[m_position]; };
+		void advance();
+
+	private:
+		void fill();
+
+		std::ifstream m_stream;
+		std::vector<TripletRecord> m_buffer;
+		size_t m_position;
+	};
+
+	// Orders the heap so the reader with the smallest current record is on top
+	bool readerAfter(const size_t& lhs, const size_t& rhs) const;
+
+	std::vector<std::unique_ptr<RunReader>> m_readers;
+	std::vector<size_t> m_heap;
+};
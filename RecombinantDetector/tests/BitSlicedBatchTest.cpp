@@ -0,0 +1,79 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "../core/Alignment.h"
+#include "../core/BitSlicedBatch.h"
+
+namespace {
+	const uint64_t SEED = 20260418;
+	// The children are a few, every (dad, mum) pair of the blocks is what the engine slices
+	const size_t CHILD_COUNT = 4;
+
+	// More than a block of parents, so the blocks and the lanes above the dad are both exercised
+	std::vector<TestUtils::AlignmentShape> batchShapes() {
+		return {
+			{ 70, 1, 0.0, 0.0, 0.5 },
+			{ 130, 65, 0.1, 0.0, 0.3 },
+			{ 130, 1000, 0.2, 0.005, 0.1 },
+			{ 200, 300, 0.05, 0.01, 0.2 },
+			{ 70, 5000, 0.02, 0.001, 0.3 },
+		};
+	}
+
+	void checkBatch(const std::vector<SequencePtr>& sequences, const std::string& caseName) {
+		ParentColumnBitmaps parents;
+		parents.build(sequences);
+		CHECK_EQUAL(sequences.size(), parents.parentCount());
+		BitSlicedBatch batch(parents);
+
+		for (size_t childIdx = 0; childIdx < CHILD_COUNT; childIdx++) {
+			const auto& child = *sequences[childIdx];
+			for (size_t dadIdx = 0; dadIdx < sequences.size(); dadIdx++) {
+				const auto& dad = *sequences[dadIdx];
+				batch.setPair(child, dad);
+				for (size_t blockIdx = (dadIdx + 1) / ParentColumnBitmaps::BLOCK_SIZE; blockIdx < parents.blockCount(); blockIdx++) {
+					batch.run(blockIdx);
+					auto lanes = BitSlicedBatch::lanesAbove(blockIdx, dadIdx);
+					for (size_t lane = 0; lane < ParentColumnBitmaps::BLOCK_SIZE; lane++) {
+						auto mumIdx = blockIdx * ParentColumnBitmaps::BLOCK_SIZE + lane;
+						CHECK_EQUAL(mumIdx > dadIdx, ((lanes >> lane) & 1) != 0);
+						if (mumIdx <= dadIdx || mumIdx >= sequences.size()) {
+							continue;
+						}
+						const auto& mum = *sequences[mumIdx];
+						TestUtils::context() = caseName + ": " + child.name() + ", " + dad.name() + ", " + mum.name();
+						CHECK_EQUAL(TestUtils::scalarWalk(child, dad, mum), batch.laneSummary(lane));
+					}
+				}
+			}
+		}
+	}
+}
+
+int main() {
+	std::mt19937_64 random(SEED);
+
+	for (const auto& shape : batchShapes()) {
+		// All the sites, and the polymorphic ones only as the detection uses by default
+		for (bool isPolymorphicOnly : { false, true }) {
+			auto sequences = TestUtils::randomSequences(random, shape);
+			Alignment alignment;
+			alignment.addSequences(sequences, true, true);
+			if (isPolymorphicOnly) {
+				if (shape.length < BitPlanes::WORD_BITS) {
+					continue;
+				}
+				alignment.excludeMonomorphicColumns();
+			}
+			else {
+				alignment.lock();
+			}
+
+			checkBatch(sequences, TestUtils::describe(shape, isPolymorphicOnly));
+		}
+	}
+
+	return TestUtils::finish("BitSlicedBatchTest");
+}
@@ -0,0 +1,151 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "../app/PTable.h"
+#include "../app/PTableFile.h"
+#include "../app/UserSettings.h"
+
+namespace {
+	const long M_SIZE = 40;
+	const long N_SIZE = 50;
+	const long K_SIZE = 45;
+
+	// The header of a version 2 file is followed by the index, the values start at a 64K boundary
+	const size_t INDEX_OFFSET = 104;
+	const size_t DATA_OFFSET = 1 << 16;
+
+	const UserSettings::PTableLoading LOADINGS[] = {
+		UserSettings::PTableLoading::Read,
+		UserSettings::PTableLoading::Map,
+		UserSettings::PTableLoading::MapPrefetch
+	};
+
+	std::string describe(const UserSettings::PTableLoading& loading) {
+		switch (loading) {
+		case UserSettings::PTableLoading::Read: return "read";
+		case UserSettings::PTableLoading::Map: return "map";
+		default: return "map and prefetch";
+		}
+	}
+
+	// The values or the codes of the table, whatever its encoding
+	std::vector<char> storedBytes(const PTable& table) {
+		auto size = table.getNumStoredVals() * PTable::valueSize(table.getEncoding());
+		auto data = (table.getEncoding() == PTable::Encoding::Log16)
+			? reinterpret_cast<const char*> (table.getCodesPtr())
+			: reinterpret_cast<const char*> (table.getDataPtr());
+		return std::vector<char>(data, data + size);
+	}
+
+	PTableFile::ReadResult load(const std::filesystem::path& path, const UserSettings::PTableLoading& loading) {
+		UserSettings::instance().pTableLoading = loading;
+		PTableFile file(path.string());
+		return file.tryLoadInto(PTable::instance());
+	}
+
+	// The table loaded from the file in every mode must be the one that was saved
+	void checkLoading(const std::filesystem::path& path, const PTable::Encoding& encoding, const std::vector<char>& expected) {
+		auto& table = PTable::instance();
+		for (auto loading : LOADINGS) {
+			TestUtils::context() = path.filename().string() + ", " + describe(loading);
+			CHECK_EQUAL(PTableFile::SUCCESS, load(path, loading));
+			CHECK(table.waitForVerification());
+			CHECK(table.getMSize() == M_SIZE && table.getNSize() == N_SIZE && table.getKSize() == K_SIZE);
+			CHECK(table.getEncoding() == encoding);
+			CHECK(storedBytes(table) == expected);
+		}
+		TestUtils::context().clear();
+	}
+
+	// The format written by the versions before the checksums
+	void saveLegacy(const std::filesystem::path& path, const std::vector<char>& values) {
+		std::ofstream stream(path, std::ios::binary);
+		int header[] = { sizeof(int), M_SIZE, N_SIZE, K_SIZE };
+		stream.write("P-table", 8);
+		stream.write(reinterpret_cast<const char*> (header), sizeof(header));
+		stream.write(values.data(), values.size());
+	}
+
+	void flipByte(const std::filesystem::path& path, const size_t& offset) {
+		std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+		stream.seekg(offset);
+		char byte = static_cast<char>(stream.get());
+		stream.seekp(offset);
+		stream.put(static_cast<char>(byte ^ 0x10));
+	}
+
+	// A legacy table is loaded, converted to Log16 and saved, then loaded again
+	void checkRoundTrip(const std::filesystem::path& directory) {
+		auto& table = PTable::instance();
+		table.generateTable(M_SIZE, N_SIZE, K_SIZE);
+		auto values = storedBytes(table);
+
+		auto path = directory / "table";
+		CHECK(PTableFile(path.string()).save(table));
+		checkLoading(path, PTable::Encoding::Float32, values);
+
+		auto legacyPath = directory / "legacy";
+		saveLegacy(legacyPath, values);
+		checkLoading(legacyPath, PTable::Encoding::Float32, values);
+
+		// As -convert-p does
+		CHECK_EQUAL(PTableFile::SUCCESS, load(legacyPath, UserSettings::PTableLoading::Map));
+		table.encode(PTable::Encoding::Log16);
+		auto codes = storedBytes(table);
+		auto convertedPath = directory / "converted";
+		CHECK(table.saveToFile(convertedPath.string()));
+
+		std::vector<uint16_t> expectedCodes(codes.size() / sizeof(uint16_t));
+		const float* floats = reinterpret_cast<const float*> (values.data());
+		for (size_t i = 0; i < expectedCodes.size(); i++) {
+			expectedCodes[i] = PTable::encodeLog16(floats[i]);
+		}
+		CHECK(std::memcmp(codes.data(), expectedCodes.data(), codes.size()) == 0);
+		checkLoading(convertedPath, PTable::Encoding::Log16, codes);
+	}
+
+	// A corrupt index is always detected, corrupt values only when the table is verified
+	void checkCorruption(const std::filesystem::path& directory) {
+		auto& settings = UserSettings::instance();
+		auto& table = PTable::instance();
+		table.generateTable(M_SIZE, N_SIZE, K_SIZE);
+		auto path = directory / "corrupt";
+
+		settings.verifyPTable = false;
+		CHECK(PTableFile(path.string()).save(table));
+		flipByte(path, INDEX_OFFSET + 10 * sizeof(int64_t));
+		for (auto loading : { UserSettings::PTableLoading::Map, UserSettings::PTableLoading::MapPrefetch }) {
+			TestUtils::context() = "corrupt index, " + describe(loading);
+			CHECK_EQUAL(PTableFile::FILE_CORRUPT, load(path, loading));
+		}
+
+		settings.verifyPTable = true;
+		CHECK(PTableFile(path.string()).save(table));
+		flipByte(path, DATA_OFFSET + 1000 * sizeof(float));
+		TestUtils::context() = "corrupt values, read";
+		CHECK_EQUAL(PTableFile::FILE_CORRUPT, load(path, UserSettings::PTableLoading::Read));
+		for (auto loading : { UserSettings::PTableLoading::Map, UserSettings::PTableLoading::MapPrefetch }) {
+			// A mapped table is checked in the background, while it is used
+			TestUtils::context() = "corrupt values, " + describe(loading);
+			CHECK_EQUAL(PTableFile::SUCCESS, load(path, loading));
+			CHECK(!table.waitForVerification());
+		}
+		TestUtils::context().clear();
+	}
+}
+
+int main() {
+	auto directory = std::filesystem::temp_directory_path() / "RecDetectorPTableFileTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	checkRoundTrip(directory);
+	checkCorruption(directory);
+
+	std::filesystem::remove_all(directory);
+	return TestUtils::finish("PTableFileTest");
+}
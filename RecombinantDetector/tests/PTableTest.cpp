@@ -0,0 +1,93 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "../app/PTable.h"
+#include "../app/UserSettings.h"
+
+namespace {
+	const long M_SIZE = 70;
+	const long N_SIZE = 90;
+	const long K_SIZE = 80;
+
+	// The values of the table generated on the given number of threads
+	std::vector<float> generate(const size_t& threadCount) {
+		UserSettings::instance().pTableThreadsCount = threadCount;
+		auto& table = PTable::instance();
+		table.generateTable(M_SIZE, N_SIZE, K_SIZE);
+		return std::vector<float>(table.getDataPtr(), table.getDataPtr() + table.getNumStoredVals());
+	}
+
+	// The wavefront of the cells gives the same bits for any thread count
+	void checkParallelGeneration() {
+		auto serial = generate(1);
+		CHECK(!serial.empty());
+		for (size_t threadCount : { 2, 4, 7 }) {
+			TestUtils::context() = std::to_string(threadCount) + " threads";
+			auto parallel = generate(threadCount);
+			CHECK_EQUAL(serial.size(), parallel.size());
+			if (serial.size() == parallel.size()) {
+				CHECK(std::memcmp(serial.data(), parallel.data(), serial.size() * sizeof(float)) == 0);
+			}
+		}
+		TestUtils::context().clear();
+	}
+
+	// The bound of the relative error of a code, and the rounding of the decoded float
+	const double LOG16_MAX_ERROR = std::exp2(std::exp2(-PTable::LOG16_FRACTION_BITS - 1)) - 1 + std::exp2(-23);
+
+	bool isWithinLog16Error(const float& pValue, const uint16_t& code) {
+		return std::fabs(static_cast<double>(PTable::decodeLog16(code)) - pValue) <= LOG16_MAX_ERROR * pValue;
+	}
+
+	// Every code decodes to a value that is encoded back to it
+	void checkLog16Codes() {
+		for (uint32_t code = 0; code <= PTable::LOG16_ZERO_CODE; code++) {
+			TestUtils::context() = "code " + std::to_string(code);
+			CHECK_EQUAL(static_cast<uint16_t>(code), PTable::encodeLog16(PTable::decodeLog16(static_cast<uint16_t>(code))));
+		}
+		TestUtils::context().clear();
+	}
+
+	// The normal floats up to 1, and the values of a generated table, are within the error bound once encoded
+	void checkLog16Error() {
+		const uint32_t STRIDE = 997;
+		uint32_t minBits, maxBits;
+		float minNormal = std::numeric_limits<float>::min();
+		float one = 1.0f;
+		std::memcpy(&minBits, &minNormal, sizeof(float));
+		std::memcpy(&maxBits, &one, sizeof(float));
+		for (uint32_t bits = minBits; bits <= maxBits; bits += STRIDE) {
+			float pValue;
+			std::memcpy(&pValue, &bits, sizeof(float));
+			if (!isWithinLog16Error(pValue, PTable::encodeLog16(pValue))) {
+				TestUtils::context() = "p " + std::to_string(pValue);
+				CHECK(isWithinLog16Error(pValue, PTable::encodeLog16(pValue)));
+			}
+		}
+
+		auto values = generate(1);
+		auto& table = PTable::instance();
+		table.encode(PTable::Encoding::Log16);
+		CHECK_EQUAL(values.size(), static_cast<size_t>(table.getNumStoredVals()));
+		for (size_t i = 0; i < values.size() && i < static_cast<size_t>(table.getNumStoredVals()); i++) {
+			if (values[i] >= minNormal && !isWithinLog16Error(values[i], table.getCodesPtr()[i])) {
+				TestUtils::context() = "value " + std::to_string(i) + " of the table";
+				CHECK(isWithinLog16Error(values[i], table.getCodesPtr()[i]));
+			}
+		}
+		TestUtils::context().clear();
+	}
+}
+
+int main() {
+	checkParallelGeneration();
+	checkLog16Codes();
+	checkLog16Error();
+
+	return TestUtils::finish("PTableTest");
+}
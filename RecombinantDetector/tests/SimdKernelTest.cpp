@@ -0,0 +1,54 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "../core/Alignment.h"
+#include "../core/SimdKernel.h"
+
+namespace {
+	const uint64_t SEED = 20260419;
+
+	// The dense rows of the active matrix with the selected instruction set
+	void checkLevel(const std::vector<SequencePtr>& sequences, const std::string& caseName) {
+		TestUtils::forEachTriplet(sequences, caseName, [](const Sequence& child, const Sequence& dad, const Sequence& mum) {
+			CHECK_EQUAL(TestUtils::scalarWalk(child, dad, mum), SimdKernel::computeMirroredSteps(child.activeRow().data,
+				dad.activeRow().data, mum.activeRow().data, child.activeRow().paddedLength));
+			});
+	}
+}
+
+int main() {
+	std::mt19937_64 random(SEED);
+	const SimdKernel::Level levels[] = { SimdKernel::Level::Scalar, SimdKernel::Level::SSE42,
+		SimdKernel::Level::AVX2, SimdKernel::Level::AVX512 };
+
+	for (const auto& shape : TestUtils::kernelShapes()) {
+		// All the sites, and the polymorphic ones only as the detection uses by default
+		for (bool isPolymorphicOnly : { false, true }) {
+			auto sequences = TestUtils::randomSequences(random, shape);
+			Alignment alignment;
+			alignment.addSequences(sequences, true, true);
+			if (isPolymorphicOnly) {
+				if (shape.length < BitPlanes::WORD_BITS) {
+					continue;
+				}
+				alignment.excludeMonomorphicColumns();
+			}
+			else {
+				alignment.lock();
+			}
+
+			for (auto level : levels) {
+				// The levels the CPU lacks cannot be run, the detection falls back from them too
+				if (!SimdKernel::isSupported(level)) {
+					continue;
+				}
+				SimdKernel::selectLevel(level);
+				checkLevel(sequences, TestUtils::describe(shape, isPolymorphicOnly) + ", " + SimdKernel::levelName(level));
+			}
+		}
+	}
+
+	return TestUtils::finish("SimdKernelTest");
+}
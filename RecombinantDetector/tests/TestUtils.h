@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../core/Sequence.h"
+#include "../core/TripletKernel.h"
+
+// The summaries are compared and printed by the checks
+inline std::ostream& operator<<(std::ostream& stream, const RandomWalkSummary& summary) {
+	return stream << "(m " << summary.upSteps << ", n " << summary.downSteps << ", k " << summary.maxDescent << ")";
+}
+
+inline std::ostream& operator<<(std::ostream& stream, const MirroredWalkSummary& summary) {
+	return stream << "(m " << summary.upSteps << ", n " << summary.downSteps
+		<< ", k " << summary.maxDescent << ", mirrored k " << summary.maxAscent << ")";
+}
+
+inline bool operator==(const RandomWalkSummary& lhs, const RandomWalkSummary& rhs) {
+	return lhs.upSteps == rhs.upSteps && lhs.downSteps == rhs.downSteps && lhs.maxDescent == rhs.maxDescent;
+}
+
+inline bool operator==(const MirroredWalkSummary& lhs, const MirroredWalkSummary& rhs) {
+	return lhs.upSteps == rhs.upSteps && lhs.downSteps == rhs.downSteps
+		&& lhs.maxDescent == rhs.maxDescent && lhs.maxAscent == rhs.maxAscent;
+}
+
+/**
+ * The checks of the test programs. A failed check is reported with the current context and the
+ * program goes on, its exit code is the number of failed checks (see finish()).
+ */
+namespace TestUtils {
+
+	inline size_t& failureCount() {
+		static size_t count = 0;
+		return count;
+	}
+
+	// Describes the case being checked, e.g. the seed and the triplet
+	inline std::string& context() {
+		static std::string context;
+		return context;
+	}
+
+	inline void fail(const std::string& message, const char* file, int line) {
+		// A broken kernel fails every triplet, the first failures are enough to tell why
+		static const size_t MAX_REPORTED_FAILURES = 20;
+		if (++failureCount() <= MAX_REPORTED_FAILURES) {
+			std::cerr << file << ":" << line << ": " << message;
+			if (!context().empty()) {
+				std::cerr << " [" << context() << "]";
+			}
+			std::cerr << std::endl;
+		}
+	}
+
+	template <class Expected, class Actual>
+	void checkEqual(const Expected& expected, const Actual& actual, const char* expression, const char* file, int line) {
+		if (!(expected == actual)) {
+			std::ostringstream message;
+			message << expression << " is " << actual << ", expected " << expected;
+			fail(message.str(), file, line);
+		}
+	}
+
+	inline int finish(const std::string& testName) {
+		if (failureCount() == 0) {
+			std::cout << testName << ": all checks passed" << std::endl;
+			return 0;
+		}
+		std::cout << testName << ": " << failureCount() << " checks failed" << std::endl;
+		return static_cast<int>(std::min<size_t>(failureCount(), 255));
+	}
+
+	/**
+	 * The summary of (child, dad, mum) and its mirror from the site-by-site walk of 3SEQ,
+	 * the definition every kernel must match.
+	 */
+	inline MirroredWalkSummary scalarWalk(const Sequence& child, const Sequence& dad, const Sequence& mum) {
+		long upSteps = 0;
+		long downSteps = 0;
+		long height = 0;
+		long maxHeight = 0;
+		long minHeight = 0;
+		long maxDescent = 0;
+		long maxAscent = 0;
+
+		for (size_t activeNuIdx = 0; activeNuIdx < child.activeLength(); activeNuIdx++) {
+			auto childNu = child.getActiveNuc(activeNuIdx);
+			auto dadNu = dad.getActiveNuc(activeNuIdx);
+			auto mumNu = mum.getActiveNuc(activeNuIdx);
+			if (childNu != Nucleotide::Gap && dadNu != Nucleotide::Gap && mumNu != Nucleotide::Gap) {
+				if (dadNu == childNu && mumNu != childNu) {
+					upSteps++;
+					height++;
+				}
+				else if (dadNu != childNu && mumNu == childNu) {
+					downSteps++;
+					height--;
+				}
+			}
+			maxHeight = std::max(maxHeight, height);
+			minHeight = std::min(minHeight, height);
+			maxDescent = std::max(maxDescent, maxHeight - height);
+			maxAscent = std::max(maxAscent, height - minHeight);
+		}
+
+		return MirroredWalkSummary{ upSteps, downSteps, maxDescent, maxAscent };
+	}
+
+	// The shape of a random alignment
+	struct AlignmentShape {
+		size_t sequenceCount;
+		size_t length;
+		// The probability of a gap at a site, and of a gap run starting at a site
+		double gapRate;
+		double gapRunRate;
+		// The probability of a mutation at a site of a sequence relative to the root
+		double mutationRate;
+	};
+
+	inline std::string describe(const AlignmentShape& shape, const bool& isPolymorphicOnly) {
+		std::ostringstream description;
+		description << shape.sequenceCount << " sequences of " << shape.length << " sites, gap rate " << shape.gapRate
+			<< (isPolymorphicOnly ? ", polymorphic sites" : ", all sites");
+		return description.str();
+	}
+
+	// Call check(child, dad, mum) for every ordered triplet of distinct sequences
+	template <class Check>
+	void forEachTriplet(const std::vector<SequencePtr>& sequences, const std::string& caseName, const Check& check) {
+		for (const auto& child : sequences) {
+			for (const auto& dad : sequences) {
+				for (const auto& mum : sequences) {
+					if (child == dad || child == mum || dad == mum) {
+						continue;
+					}
+					context() = caseName + ": " + child->name() + ", " + dad->name() + ", " + mum->name();
+					check(*child, *dad, *mum);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Random sequences descending from a common root, some of them recombinants of two earlier
+	 * ones, so the walks have long runs of steps in one direction as well as noise. Gaps are
+	 * scattered and in runs, and some of them are written as N.
+	 */
+	inline std::vector<SequencePtr> randomSequences(std::mt19937_64& random, const AlignmentShape& shape) {
+		static const char NUCLEOTIDES[] = { 'A', 'C', 'G', 'T' };
+		static const size_t MAX_GAP_RUN = 150;
+		std::uniform_real_distribution<double> probability(0.0, 1.0);
+		std::uniform_int_distribution<int> nucleotide(0, 3);
+
+		std::string root(shape.length, 'A');
+		for (auto& site : root) {
+			site = NUCLEOTIDES[nucleotide(random)];
+		}
+
+		std::vector<std::string> dnas;
+		for (size_t seqIdx = 0; seqIdx < shape.sequenceCount; seqIdx++) {
+			std::string dna = root;
+			if (seqIdx >= 2 && probability(random) < 0.4) {
+				// A recombinant of two earlier sequences, switching at two breakpoints
+				std::uniform_int_distribution<size_t> earlier(0, seqIdx - 1);
+				std::uniform_int_distribution<size_t> position(0, shape.length);
+				const auto& dad = dnas[earlier(random)];
+				const auto& mum = dnas[earlier(random)];
+				auto first = position(random);
+				auto second = position(random);
+				if (first > second) std::swap(first, second);
+				dna = dad.substr(0, first) + mum.substr(first, second - first) + dad.substr(second);
+			}
+
+			for (size_t site = 0; site < shape.length; site++) {
+				if (probability(random) < shape.mutationRate) {
+					dna[site] = NUCLEOTIDES[nucleotide(random)];
+				}
+				if (probability(random) < shape.gapRate) {
+					dna[site] = '-';
+				}
+				if (probability(random) < shape.gapRunRate) {
+					std::uniform_int_distribution<size_t> runLength(1, MAX_GAP_RUN);
+					auto end = std::min(shape.length, site + runLength(random));
+					for (auto gapSite = site; gapSite < end; gapSite++) {
+						dna[gapSite] = probability(random) < 0.5 ? '-' : 'N';
+					}
+				}
+			}
+			dnas.push_back(dna);
+		}
+
+		std::vector<SequencePtr> sequences;
+		for (size_t seqIdx = 0; seqIdx < dnas.size(); seqIdx++) {
+			sequences.push_back(Sequence::create("seq" + std::to_string(seqIdx), dnas[seqIdx]));
+		}
+		return sequences;
+	}
+
+	/**
+	 * The shapes every kernel is checked on: lengths around the word and block boundaries, walks
+	 * longer than a byte can count, without gaps and with many of them.
+	 */
+	inline std::vector<AlignmentShape> kernelShapes() {
+		return {
+			{ 8, 1, 0.0, 0.0, 0.5 },
+			{ 8, 63, 0.0, 0.0, 0.3 },
+			{ 8, 64, 0.1, 0.0, 0.3 },
+			{ 8, 65, 0.1, 0.0, 0.3 },
+			{ 10, 200, 0.05, 0.01, 0.2 },
+			{ 10, 1000, 0.0, 0.0, 0.05 },
+			{ 10, 1000, 0.2, 0.005, 0.1 },
+			{ 12, 5000, 0.02, 0.001, 0.3 },
+			{ 6, 20000, 0.01, 0.0005, 0.4 },
+		};
+	}
+}
+
+#define CHECK(condition) \
+	do { if (!(condition)) TestUtils::fail("check failed: " #condition, __FILE__, __LINE__); } while (false)
+
+#define CHECK_EQUAL(expected, actual) \
+	TestUtils::checkEqual((expected), (actual), #actual, __FILE__, __LINE__)
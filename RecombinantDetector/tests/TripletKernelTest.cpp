@@ -0,0 +1,81 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "../core/Alignment.h"
+#include "../core/ParentPairIndex.h"
+#include "../core/TripletKernel.h"
+
+namespace {
+	const uint64_t SEED = 20260417;
+
+	// m, n and k of the bit-packed kernel against the site-by-site walk
+	void checkComputeSteps(const std::vector<SequencePtr>& sequences, const std::string& caseName) {
+		TestUtils::forEachTriplet(sequences, caseName, [](const Sequence& child, const Sequence& dad, const Sequence& mum) {
+			CHECK_EQUAL(TestUtils::scalarWalk(child, dad, mum).forward(),
+				TripletKernel::computeSteps(child.bitPlanes(), dad.bitPlanes(), mum.bitPlanes()));
+			});
+	}
+
+	// Both orientations from a single scan, the mirror must be the walk of (child, mum, dad) itself
+	void checkComputeMirroredSteps(const std::vector<SequencePtr>& sequences, const std::string& caseName) {
+		TestUtils::forEachTriplet(sequences, caseName, [](const Sequence& child, const Sequence& dad, const Sequence& mum) {
+			auto summary = TripletKernel::computeMirroredSteps(child.bitPlanes(), dad.bitPlanes(), mum.bitPlanes());
+			CHECK_EQUAL(TestUtils::scalarWalk(child, dad, mum), summary);
+			CHECK_EQUAL(TestUtils::scalarWalk(child, mum, dad).forward(), summary.mirrored());
+			});
+	}
+
+	// The sites where both parents are known and differ, whatever the child is
+	size_t countInformativeSites(const Sequence& dad, const Sequence& mum) {
+		size_t siteCount = 0;
+		for (size_t activeNuIdx = 0; activeNuIdx < dad.activeLength(); activeNuIdx++) {
+			auto dadNu = dad.getActiveNuc(activeNuIdx);
+			auto mumNu = mum.getActiveNuc(activeNuIdx);
+			if (dadNu != Nucleotide::Gap && mumNu != Nucleotide::Gap && dadNu != mumNu) {
+				siteCount++;
+			}
+		}
+		return siteCount;
+	}
+
+	// The walk over the informative sites of the parent pair only
+	void checkParentPairIndex(const std::vector<SequencePtr>& sequences, const std::string& caseName) {
+		ParentPairIndex pairIndex;
+		TestUtils::forEachTriplet(sequences, caseName, [&pairIndex](const Sequence& child, const Sequence& dad, const Sequence& mum) {
+			pairIndex.build(dad.bitPlanes(), mum.bitPlanes());
+			CHECK_EQUAL(countInformativeSites(dad, mum), pairIndex.siteCount);
+			CHECK_EQUAL(TestUtils::scalarWalk(child, dad, mum), TripletKernel::computeMirroredSteps(child.bitPlanes(), pairIndex));
+			});
+	}
+}
+
+int main() {
+	std::mt19937_64 random(SEED);
+
+	for (const auto& shape : TestUtils::kernelShapes()) {
+		// All the sites, and the polymorphic ones only as the detection uses by default
+		for (bool isPolymorphicOnly : { false, true }) {
+			auto sequences = TestUtils::randomSequences(random, shape);
+			Alignment alignment;
+			alignment.addSequences(sequences, true, true);
+			if (isPolymorphicOnly) {
+				if (shape.length < BitPlanes::WORD_BITS) {
+					continue;
+				}
+				alignment.excludeMonomorphicColumns();
+			}
+			else {
+				alignment.lock();
+			}
+
+			auto caseName = TestUtils::describe(shape, isPolymorphicOnly);
+			checkComputeSteps(sequences, caseName);
+			checkComputeMirroredSteps(sequences, caseName);
+			checkParentPairIndex(sequences, caseName);
+		}
+	}
+
+	return TestUtils::finish("TripletKernelTest");
+}
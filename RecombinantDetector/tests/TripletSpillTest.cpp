@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "TestUtils.h"
+#include "../core/TripletPool.h"
+#include "../core/TripletSpill.h"
+
+namespace {
+	const uint64_t SEED = 20260420;
+	const size_t CHILD_COUNT = 40;
+	const size_t PARENT_COUNT = 60;
+	// Several read buffers of a run (4096 records), so the runs are read back in pieces
+	const size_t RECORD_COUNT = 20000;
+
+	// Distinct triplets in a random order, with p-values that do not follow the indices
+	std::vector<TripletRecord> randomRecords(std::mt19937_64& random) {
+		std::uniform_int_distribution<uint32_t> child(0, CHILD_COUNT - 1);
+		std::uniform_int_distribution<uint32_t> parent(0, PARENT_COUNT - 1);
+		std::uniform_real_distribution<double> pValue(1e-12, 1e-3);
+
+		std::set<std::tuple<uint32_t, uint32_t, uint32_t>> triplets;
+		std::vector<TripletRecord> records;
+		while (records.size() < RECORD_COUNT) {
+			TripletRecord record;
+			record.childIdx = child(random);
+			record.dadIdx = parent(random);
+			record.mumIdx = parent(random);
+			if (record.dadIdx == record.mumIdx
+				|| !triplets.insert(std::make_tuple(record.childIdx, record.dadIdx, record.mumIdx)).second) {
+				continue;
+			}
+			record.upSteps = static_cast<int32_t>(record.dadIdx + 10);
+			record.downSteps = static_cast<int32_t>(record.mumIdx + 10);
+			record.maxDescent = static_cast<int32_t>(record.childIdx + 5);
+			record.isApproximate = record.childIdx % 2;
+			record.pValue = pValue(random);
+			records.push_back(record);
+		}
+		return records;
+	}
+
+	bool isSameRecord(const TripletRecord& lhs, const TripletRecord& rhs) {
+		return lhs.childIdx == rhs.childIdx && lhs.dadIdx == rhs.dadIdx && lhs.mumIdx == rhs.mumIdx
+			&& lhs.upSteps == rhs.upSteps && lhs.downSteps == rhs.downSteps && lhs.maxDescent == rhs.maxDescent
+			&& lhs.isApproximate == rhs.isApproximate && lhs.pValue == rhs.pValue;
+	}
+
+	// The merge of several sorted runs gives every child once, with all its records ordered by (dad, mum)
+	void checkMerge(std::mt19937_64& random, const std::filesystem::path& directory) {
+		static const size_t RUN_COUNT = 7;
+		TestUtils::context() = "merge of " + std::to_string(RUN_COUNT) + " runs";
+
+		auto records = randomRecords(random);
+		std::vector<std::vector<TripletRecord>> runRecords(RUN_COUNT);
+		std::uniform_int_distribution<size_t> runOf(0, RUN_COUNT - 1);
+		for (const auto& record : records) {
+			runRecords[runOf(random)].push_back(record);
+		}
+		std::vector<std::filesystem::path> runs;
+		for (auto& run : runRecords) {
+			std::sort(run.begin(), run.end(), TripletSpill::runOrder);
+			runs.push_back(TripletSpill::writeRun(directory, run));
+		}
+
+		std::sort(records.begin(), records.end(), TripletSpill::runOrder);
+		std::vector<TripletRecord> merged;
+		{
+			TripletRunMerger merger(runs);
+			std::vector<TripletRecord> childRecords;
+			while (merger.nextChild(childRecords)) {
+				CHECK(!childRecords.empty());
+				for (const auto& record : childRecords) {
+					CHECK_EQUAL(childRecords.front().childIdx, record.childIdx);
+				}
+				if (!merged.empty() && !childRecords.empty()) {
+					CHECK(merged.back().childIdx < childRecords.front().childIdx);
+				}
+				merged.insert(merged.end(), childRecords.begin(), childRecords.end());
+			}
+		}
+
+		CHECK_EQUAL(records.size(), merged.size());
+		for (size_t recordIdx = 0; recordIdx < std::min(records.size(), merged.size()); recordIdx++) {
+			CHECK(isSameRecord(records[recordIdx], merged[recordIdx]));
+		}
+
+		TripletSpill::removeRuns(runs);
+		CHECK(runs.empty());
+	}
+
+	// The pools of the threads spill as they go over their budget and the result pool takes the runs over
+	void checkPoolSpilling(std::mt19937_64& random, const std::filesystem::path& directory) {
+		static const size_t THREAD_COUNT = 3;
+		static const size_t MAX_RECORDS = 1000;
+		TestUtils::context() = "spilling of " + std::to_string(THREAD_COUNT) + " pools";
+
+		std::vector<SequencePtr> children;
+		for (size_t childIdx = 0; childIdx < CHILD_COUNT; childIdx++) {
+			children.push_back(Sequence::create("child" + std::to_string(childIdx), "ACGT"));
+		}
+		std::vector<SequencePtr> parents;
+		for (size_t parentIdx = 0; parentIdx < PARENT_COUNT; parentIdx++) {
+			parents.push_back(Sequence::create("parent" + std::to_string(parentIdx), "ACGT"));
+		}
+
+		auto records = randomRecords(random);
+		std::vector<size_t> expectedCounts(CHILD_COUNT, 0);
+		{
+			TripletPool result;
+			result.setStorageMode(TripletPool::StorageMode::AllTriplets);
+			result.setSequences(children, parents);
+
+			std::vector<TripletPool> threadPools(THREAD_COUNT);
+			for (auto& threadPool : threadPools) {
+				threadPool.setStorageMode(TripletPool::StorageMode::AllTriplets);
+				threadPool.setSequences(children, parents);
+				threadPool.setSpilling(directory, MAX_RECORDS);
+			}
+			for (size_t recordIdx = 0; recordIdx < records.size(); recordIdx++) {
+				threadPools[recordIdx % THREAD_COUNT].saveTriplet<TripletPool::StorageMode::AllTriplets>(records[recordIdx]);
+				expectedCounts[records[recordIdx].childIdx]++;
+			}
+			for (const auto& threadPool : threadPools) {
+				CHECK(threadPool.isSpilled());
+			}
+
+			result.adoptSpilledRuns(threadPools);
+			CHECK(result.isSpilled());
+			for (size_t childIdx = 0; childIdx < CHILD_COUNT; childIdx++) {
+				CHECK_EQUAL(expectedCounts[childIdx], result.getRecombinantCount(childIdx));
+				CHECK_EQUAL(expectedCounts[childIdx] != 0, result.hasTriplets(childIdx));
+			}
+		}
+
+		// The pools remove their runs
+		CHECK(std::filesystem::is_empty(directory));
+	}
+
+	// The runs of a pool that is still alive are removed on demand, as before exiting on an error
+	void checkDiscardSpilledRuns(std::mt19937_64& random, const std::filesystem::path& directory) {
+		static const size_t MAX_RECORDS = 1000;
+		TestUtils::context() = "discarded runs";
+
+		std::vector<SequencePtr> children;
+		for (size_t childIdx = 0; childIdx < CHILD_COUNT; childIdx++) {
+			children.push_back(Sequence::create("child" + std::to_string(childIdx), "ACGT"));
+		}
+		std::vector<SequencePtr> parents;
+		for (size_t parentIdx = 0; parentIdx < PARENT_COUNT; parentIdx++) {
+			parents.push_back(Sequence::create("parent" + std::to_string(parentIdx), "ACGT"));
+		}
+
+		TripletPool pool;
+		pool.setStorageMode(TripletPool::StorageMode::AllTriplets);
+		pool.setSequences(children, parents);
+		pool.setSpilling(directory, MAX_RECORDS);
+		for (const auto& record : randomRecords(random)) {
+			pool.saveTriplet<TripletPool::StorageMode::AllTriplets>(record);
+		}
+		CHECK(pool.isSpilled());
+		CHECK(!std::filesystem::is_empty(directory));
+
+		pool.discardSpilledRuns();
+		CHECK(!pool.isSpilled());
+		CHECK(std::filesystem::is_empty(directory));
+	}
+}
+
+int main() {
+	std::mt19937_64 random(SEED);
+	auto directory = std::filesystem::temp_directory_path() / "RecDetectorTripletSpillTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	checkMerge(random, directory);
+	checkPoolSpilling(random, directory);
+	checkDiscardSpilledRuns(random, directory);
+
+	std::filesystem::remove_all(directory);
+	return TestUtils::finish("TripletSpillTest");
+}
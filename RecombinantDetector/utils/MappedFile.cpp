@@ -0,0 +1,59 @@
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+	if (m_data != nullptr) {
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+#endif
+}
+
+bool MappedFile::open(const std::string& path, bool prefetch) {
+#ifdef _WIN32
+	return false;
+#else
+	if (m_data != nullptr) {
+		return false;
+	}
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+	if (prefetch) {
+		flags |= MAP_POPULATE;
+	}
+#endif
+	auto size = static_cast<size_t>(fileStat.st_size);
+	void* data = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+	// The mapping stays valid without the descriptor
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	if (prefetch) {
+		madvise(data, size, MADV_WILLNEED);
+	}
+
+	m_data = static_cast<const char*>(data);
+	m_size = size;
+	return true;
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * A whole file mapped read-only into memory. The pages are shared with every other process
+ * mapping the same file, and are unmapped with the object.
+ * Mapping is only supported on POSIX systems, elsewhere open() always fails.
+ */
+class MappedFile {
+public:
+	MappedFile() = default;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile();
+
+	/**
+	 * Map the file, returns false if it cannot be mapped.
+	 * @param prefetch Read the whole file into the page cache now instead of on the first accesses
+	 */
+	bool open(const std::string& path, bool prefetch);
+
+	const char* data() const { return m_data; };
+	size_t size() const { return m_size; };
+
+private:
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+};
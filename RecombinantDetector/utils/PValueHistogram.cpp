@@ -0,0 +1,43 @@
+#include "PValueHistogram.h"
+
+#include <cassert>
+#include <cmath>
+
+PValueHistogram::PValueHistogram(size_t binsPerDecade, size_t decades)
+	: m_binsPerDecade(binsPerDecade), m_bins(binsPerDecade * decades + 1, 0) {
+	assert(binsPerDecade > 0);
+}
+
+void PValueHistogram::add(double pValue, const size_t& weight) {
+	auto lastBinIdx = m_bins.size() - 1;
+	auto position = -std::log10(pValue) * static_cast<double>(m_binsPerDecade);
+
+	// p = 0 and NaN go to the last bin too
+	size_t binIdx = lastBinIdx;
+	if (position < static_cast<double>(lastBinIdx)) {
+		binIdx = position > 0.0 ? static_cast<size_t>(position) : 0;
+	}
+	m_bins[binIdx] += weight;
+}
+
+void PValueHistogram::merge(const PValueHistogram& other) {
+	if (m_bins.empty()) {
+		*this = other;
+		return;
+	}
+	assert(m_binsPerDecade == other.m_binsPerDecade && m_bins.size() == other.m_bins.size());
+	for (size_t binIdx = 0; binIdx < m_bins.size(); binIdx++) {
+		m_bins[binIdx] += other.m_bins[binIdx];
+	}
+}
+
+double PValueHistogram::maxPValue(const size_t& binIdx) const {
+	return std::pow(10.0, -static_cast<double>(binIdx) / static_cast<double>(m_binsPerDecade));
+}
+
+double PValueHistogram::minPValue(const size_t& binIdx) const {
+	if (binIdx + 1 >= m_bins.size()) {
+		return 0.0;
+	}
+	return maxPValue(binIdx + 1);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/**
+ * Histogram of p-values binned by -log10(p): every decade is split into binsPerDecade bins,
+ * so bin i holds 10^(-(i+1)/binsPerDecade) < p <= 10^(-i/binsPerDecade).
+ * The p-values below 10^-decades share the last bin.
+ * Not thread-safe, every thread fills its own histogram and they are merged at the end.
+ */
+class PValueHistogram {
+public:
+	PValueHistogram() = default;
+	PValueHistogram(size_t binsPerDecade, size_t decades);
+
+	// Count the p-value weight times, for a p-value sampled out of weight ones
+	void add(double pValue, const size_t& weight = 1);
+
+	// An empty histogram takes the bins of the other one
+	void merge(const PValueHistogram& other);
+
+	size_t binCount() const { return m_bins.size(); };
+	size_t binsPerDecade() const { return m_binsPerDecade; };
+	size_t count(const size_t& binIdx) const { return m_bins[binIdx]; };
+
+	// The bounds of the p-values of a bin
+	double maxPValue(const size_t& binIdx) const;
+	double minPValue(const size_t& binIdx) const;
+
+private:
+	size_t m_binsPerDecade = 1;
+	std::vector<size_t> m_bins;
+};
@@ -0,0 +1,21 @@
+#include "ProgressMonitor.h"
+
+ProgressMonitor::ProgressMonitor(size_t workerCount) : m_workerCount(workerCount) {
+}
+
+void ProgressMonitor::finishWorker() {
+	bool allFinished;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finishedWorkers++;
+		allFinished = m_finishedWorkers == m_workerCount;
+	}
+	if (allFinished) {
+		m_allFinished.notify_all();
+	}
+}
+
+bool ProgressMonitor::waitFor(std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_allFinished.wait_for(lock, timeout, [this] { return m_finishedWorkers == m_workerCount; });
+}
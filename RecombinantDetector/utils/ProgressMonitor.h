@@ -0,0 +1,26 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+/**
+ * Counts the workers that are done and wakes the waiting thread when all of them are,
+ * so the progress display sleeps between the updates instead of polling.
+ */
+class ProgressMonitor {
+public:
+	explicit ProgressMonitor(size_t workerCount);
+
+	// Must be called once by every worker when it is done
+	void finishWorker();
+
+	// Sleep until all the workers are done or the timeout passes, returns true if all are done
+	bool waitFor(std::chrono::milliseconds timeout);
+
+private:
+	size_t m_workerCount;
+	size_t m_finishedWorkers = 0;
+	std::mutex m_mutex;
+	std::condition_variable m_allFinished;
+};
@@ -165,6 +165,17 @@ namespace StatisticalUtils {
 		return pVal * numTotalSamples;
 	}
 
+	long double dunnSidakInverse(long double correctedPVal, long double numTotalSamples) {
+		if (correctedPVal >= 1.0L) return 1.0L;
+		if (correctedPVal <= 0.0L) return 0.0L;
+
+		if (numTotalSamples <= 0) {
+			numTotalSamples = defaultSampleNumForPValCorrection;
+		}
+		/* 1 - (1 - correctedPVal)^(1 / numTotalSamples), without rounding 1 - p off for small p */
+		return -expm1l(log1pl(-correctedPVal) / numTotalSamples);
+	}
+
 	void setSampleNumForPValCorrection(const long double& sampleNumForPValCorrection) {
 		defaultSampleNumForPValCorrection = sampleNumForPValCorrection;
 	}
@@ -27,4 +27,41 @@ namespace StatisticalUtils {
 	long double bonferroni(long double pVal,
 		long double numTotalSamples = 0);
 
+	/* The uncorrected p-value whose Dunn-Sidak correction is correctedPVal. Every p-value above it
+	 * is corrected above correctedPVal by both corrections, as Bonferroni never corrects less. */
+	long double dunnSidakInverse(long double correctedPVal,
+		long double numTotalSamples = 0);
+
+	// The corrections as types, to be chosen at compile time
+	struct DunnSidakCorrection {
+		// The result columns of the corrected p-values
+		static constexpr const char* COLUMN_NAME = "Dunn_Sidak_Corr(p)";
+		static constexpr const char* SHORT_COLUMN_NAME = "DS(p)";
+
+		static long double correct(long double pVal, long double numTotalSamples) {
+			return dunnSidak(pVal, numTotalSamples);
+		}
+	};
+
+	struct BonferroniCorrection {
+		static constexpr const char* COLUMN_NAME = "Bonferroni_Corr(p)";
+		static constexpr const char* SHORT_COLUMN_NAME = "B(p)";
+
+		static long double correct(long double pVal, long double numTotalSamples) {
+			return bonferroni(pVal, numTotalSamples);
+		}
+	};
+
+	// The correction chosen for the detection, for the code that is not compiled per correction
+	struct Correction {
+		long double (*correct)(long double pVal, long double numTotalSamples);
+		const char* columnName;
+		const char* shortColumnName;
+
+		template <class CorrectionType>
+		static Correction of() {
+			return Correction{ &CorrectionType::correct, CorrectionType::COLUMN_NAME, CorrectionType::SHORT_COLUMN_NAME };
+		}
+	};
+
 }